@@ -0,0 +1,64 @@
+/**
+ * @brief the benchmarks on a dock: flash it with pio run -e bench -t upload, then watch the serial monitor
+ *
+ * The firmware is compiled into namespace gamedock so its setup() and loop() stay out of the way, and nothing is
+ * sent or received: only the functions being measured ever run. Every result is printed as one line,
+ *   bench,esp8266,<benchmark>,<peers>,<cycles per call>,cycles
+ * which gamedock-bench --compare reads back from a saved serial log.
+ *
+ */
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#include <vector>
+#include "logRing.h"
+#include "scheduler.h"
+#include "buttons.h"
+#include "macKey.h"
+#include "seqWindow.h"
+#include "peerTable.h"
+#include "bloomFilter.h"
+#include "timingStats.h"
+#include "linkStats.h"
+#include "traceBuffer.h"
+
+namespace gamedock
+{
+#include "../src/main.cpp"
+}
+
+#define BENCH_PLATFORM "esp8266"
+#define BENCH_UNIT "cycles"
+
+static uint32_t benchNow()
+{
+  return ESP.getCycleCount();
+}
+
+#include "benchmarks.h"
+
+/**
+ * @brief how many iterations are in each batch, enough to average out the cycle counter being read twice
+ *
+ */
+static const uint16_t BENCH_ITERATIONS = 200;
+
+static void printResult(const char *name, uint8_t peers, double cost)
+{
+  Serial.printf("bench,%s,%s,%u,%.1f,%s\n", BENCH_PLATFORM, name, peers, cost, BENCH_UNIT);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(2000); // Give the serial monitor time to connect
+  Serial.println();
+  Serial.println("bench: starting");
+  runBenchmarks(BENCH_ITERATIONS, printResult);
+  Serial.println("bench: done");
+}
+
+void loop()
+{
+}
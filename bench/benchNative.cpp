@@ -0,0 +1,290 @@
+/**
+ * @brief the benchmarks on the host, and the tool that checks any platform's results against the stored baseline
+ *
+ * The firmware is the simulator's own build of it (sim/dockInstance.h), one copy in namespace gamedock, and every
+ * benchmark runs as that dock so the Arduino stand-ins have a dock to answer for. Native costs are nanoseconds on
+ * whatever machine runs them, so the native rows of the baseline only mean something on the machine that saved them;
+ * the esp8266 rows are cycles and hold on any dock.
+ *
+ */
+
+#define GAMEDOCK_SIM // The firmware's TUNABLE constants become variables
+
+#include "../sim/sim.h"
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#include <vector>
+#include "logRing.h"
+#include "scheduler.h"
+#include "buttons.h"
+#include "macKey.h"
+#include "seqWindow.h"
+#include "peerTable.h"
+#include "bloomFilter.h"
+#include "timingStats.h"
+#include "linkStats.h"
+#include "traceBuffer.h"
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+static void tuneValue(uint32_t &constant, uint32_t &value)
+{
+  if (value != SIM_TUNING_UNSET)
+  {
+    constant = value;
+  }
+  value = constant;
+}
+
+#define SIM_DOCK gamedock
+#include "../sim/dockInstance.h"
+
+const sim_dock_api SIM_DOCKS[SIM_MAX_DOCKS] = {gamedock::SIM_API};
+
+#define BENCH_PLATFORM "native"
+#define BENCH_UNIT "ns"
+
+static uint32_t benchNow()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#include "benchmarks.h"
+
+/**
+ * @brief a result or baseline row is keyed by platform, benchmark and peer count
+ *
+ */
+typedef std::tuple<std::string, std::string, unsigned> bench_key;
+typedef std::map<bench_key, double> bench_results;
+
+static bench_results g_results;
+
+/**
+ * @brief every run's cost for each result, before the median is taken
+ *
+ */
+static std::map<bench_key, std::vector<double>> g_runs;
+
+static void collectResult(const char *name, uint8_t peers, double cost)
+{
+  g_runs[bench_key(BENCH_PLATFORM, name, peers)].push_back(cost);
+}
+
+/**
+ * @brief make each result the median of its runs
+ *
+ * A busy host can slow a whole run down, and a single run saved as the baseline or compared against it would carry
+ * that with it.
+ *
+ */
+static void takeMedians()
+{
+  for (auto &runs : g_runs)
+  {
+    std::vector<double> &costs = runs.second;
+    std::sort(costs.begin(), costs.end());
+    g_results[runs.first] = costs[costs.size() / 2];
+  }
+}
+
+/**
+ * @brief read platform,benchmark,peers,cost rows, or bench,platform,benchmark,peers,cost,unit lines out of a serial log
+ *
+ * Anything else, like the header or the rest of the serial output, is skipped.
+ *
+ * @return false if the file can't be opened
+ */
+static boolean loadResults(const char *path, boolean serialLog, bench_results &results)
+{
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file))
+  {
+    char platform[32], name[64];
+    unsigned peers;
+    double cost;
+    const char *format = serialLog ? " bench,%31[^,],%63[^,],%u,%lf" : " %31[^,],%63[^,],%u,%lf";
+    const char *start = serialLog ? strstr(line, "bench,") : line; // Serial lines can pick up junk in front
+    if (start != NULL && sscanf(start, format, platform, name, &peers, &cost) == 4)
+    {
+      results[bench_key(platform, name, peers)] = cost;
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+static void printKey(FILE *file, const bench_key &key)
+{
+  fprintf(file, "%s,%s,%u", std::get<0>(key).c_str(), std::get<1>(key).c_str(), std::get<2>(key));
+}
+
+/**
+ * @brief rewrite the baseline with the new results in place of any old rows for the same platform
+ *
+ */
+static boolean saveResults(const char *path, bench_results baseline, const bench_results &results)
+{
+  const std::string &platform = std::get<0>(results.begin()->first);
+  for (auto it = baseline.begin(); it != baseline.end();)
+  {
+    it = std::get<0>(it->first) == platform ? baseline.erase(it) : std::next(it);
+  }
+  baseline.insert(results.begin(), results.end());
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+  {
+    return false;
+  }
+  fprintf(file, "platform,benchmark,peers,cost\n");
+  for (const auto &row : baseline)
+  {
+    printKey(file, row.first);
+    fprintf(file, ",%.1f\n", row.second);
+  }
+  fclose(file);
+  return true;
+}
+
+static void printUsage()
+{
+  fprintf(stderr, "usage: gamedock-bench [--iterations N] [--runs N] [--baseline FILE] [--threshold PCT] [--save]\n"
+                  "       gamedock-bench --compare SERIAL_LOG [--baseline FILE] [--threshold PCT] [--save]\n"
+                  "  --iterations N    iterations per batch, the fastest of %u batches counts (2000)\n"
+                  "  --runs N          run everything N times, the median of the runs counts (5)\n"
+                  "  --baseline FILE   platform,benchmark,peers,cost rows to compare against (bench/baseline.csv)\n"
+                  "  --threshold PCT   how much slower than the baseline counts as a regression (25)\n"
+                  "  --save            replace this platform's rows in the baseline with these results\n"
+                  "  --compare LOG     check the bench lines in a dock's serial log instead of running natively\n",
+          BENCH_BATCHES);
+}
+
+int main(int argc, char **argv)
+{
+  uint16_t iterations = 2000;
+  uint8_t runs = 5;
+  const char *baselinePath = "bench/baseline.csv";
+  const char *comparePath = NULL;
+  double threshold = 25;
+  boolean save = false;
+  for (int i = 1; i < argc; i++)
+  {
+    boolean hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--iterations") == 0 && hasValue && atoi(argv[i + 1]) > 0)
+    {
+      iterations = min(atoi(argv[++i]), UINT16_MAX);
+    }
+    else if (strcmp(argv[i], "--runs") == 0 && hasValue && atoi(argv[i + 1]) > 0)
+    {
+      runs = min(atoi(argv[++i]), UINT8_MAX);
+    }
+    else if (strcmp(argv[i], "--baseline") == 0 && hasValue)
+    {
+      baselinePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--compare") == 0 && hasValue)
+    {
+      comparePath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--threshold") == 0 && hasValue && atof(argv[i + 1]) > 0)
+    {
+      threshold = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--save") == 0)
+    {
+      save = true;
+    }
+    else
+    {
+      printUsage();
+      return 1;
+    }
+  }
+
+  if (comparePath != NULL)
+  {
+    if (!loadResults(comparePath, true, g_results))
+    {
+      fprintf(stderr, "bench: can't open %s\n", comparePath);
+      return 1;
+    }
+  }
+  else
+  {
+    sim_config config;
+    config.docks = 1;
+    Simulator sim(config);
+    sim.runAs(0, [iterations, runs]() {
+      for (uint8_t run = 0; run < runs; run++)
+      {
+        runBenchmarks(iterations, collectResult);
+      }
+    });
+    takeMedians();
+  }
+  if (g_results.empty())
+  {
+    fprintf(stderr, "bench: no results\n");
+    return 1;
+  }
+
+  bench_results baseline;
+  boolean haveBaseline = loadResults(baselinePath, false, baseline);
+  uint32_t regressions = 0;
+  uint32_t unbaselined = 0;
+  printf("platform,benchmark,peers,cost,baseline,change_pct,regressed\n");
+  for (const auto &result : g_results)
+  {
+    printKey(stdout, result.first);
+    printf(",%.1f", result.second);
+    auto old = baseline.find(result.first);
+    if (old == baseline.end() || old->second <= 0)
+    {
+      printf(",,,\n");
+      unbaselined++;
+      continue;
+    }
+    double change = (result.second / old->second - 1) * 100;
+    boolean regressed = change > threshold && result.second - old->second >= 1; // Less than a cycle or ns is noise
+    regressions += regressed;
+    printf(",%.1f,%+.1f,%s\n", old->second, change, regressed ? "yes" : "no");
+  }
+
+  if (save)
+  {
+    if (!saveResults(baselinePath, baseline, g_results))
+    {
+      fprintf(stderr, "bench: can't write %s\n", baselinePath);
+      return 1;
+    }
+    fprintf(stderr, "bench: saved %u results to %s\n", (unsigned)g_results.size(), baselinePath);
+    return 0;
+  }
+  if (!haveBaseline)
+  {
+    fprintf(stderr, "bench: no baseline at %s, run with --save to make one\n", baselinePath);
+  }
+  else if (unbaselined == g_results.size())
+  {
+    fprintf(stderr, "bench: %s has no %s rows, nothing was compared: add --save to make them\n", baselinePath,
+            std::get<0>(g_results.begin()->first).c_str());
+  }
+  else if (regressions > 0)
+  {
+    fprintf(stderr, "bench: %u results are more than %.0f%% slower than the baseline\n", regressions, threshold);
+    return 1;
+  }
+  return 0;
+}
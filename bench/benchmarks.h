@@ -0,0 +1,238 @@
+#pragma once
+
+/**
+ * @brief the receive-path benchmarks, shared by the on-device and native builds
+ *
+ * Include this after the firmware has been compiled into namespace gamedock and after defining:
+ *   BENCH_PLATFORM, the name results are reported and baselined under
+ *   BENCH_UNIT, what benchNow() counts
+ *   uint32_t benchNow(), a free running counter: CPU cycles on the dock, nanoseconds natively
+ *
+ * Every benchmark is timed a whole batch of iterations at a time. Anything that only resets state (emptying g_log,
+ * clearing a table) is timed on its own in the same batch and taken off, so reading the timer is paid once per batch
+ * rather than once per call. Reading the host's clock costs more than most of the calls being measured, and it
+ * varies, so timing single iterations made the native results jump between runs. A warm-up batch runs first and
+ * isn't counted. The fastest of BENCH_BATCHES batches is kept for both loops, so a stray interrupt or context switch
+ * doesn't count against the code being measured.
+ *
+ */
+
+/**
+ * @brief the peer counts every benchmark is run at
+ *
+ */
+static const uint8_t BENCH_PEERS[] = {2, 4, 8, 12, 16, gamedock::MAX_PEERS};
+
+/**
+ * @brief how many batches of iterations each result is the fastest of
+ *
+ */
+static const uint8_t BENCH_BATCHES = 25;
+
+/**
+ * @brief how many times the cheapest benchmarks repeat their calls per iteration, so they aren't lost in timer noise
+ *
+ */
+static const uint8_t BENCH_ROUNDS = 16;
+
+/**
+ * @brief stop the compiler from merging repeated calls to the same inline function on the same data
+ *
+ */
+#define BENCH_BARRIER() __asm__ __volatile__("" : : : "memory")
+
+/**
+ * @brief where results go: one call per benchmark and peer count, cost is BENCH_UNIT per call
+ *
+ */
+typedef void (*bench_report)(const char *name, uint8_t peers, double cost);
+
+/**
+ * @brief the addresses every benchmark works on, the same ones on every platform and every run
+ *
+ */
+static MacKey g_benchAddresses[gamedock::MAX_PEERS];
+
+/**
+ * @brief results go through here so the compiler can't throw the calls away
+ *
+ */
+static volatile uint32_t g_benchSink;
+
+static void makeBenchAddresses()
+{
+  uint32_t state = 0x2545F491;
+  for (uint8_t i = 0; i < gamedock::MAX_PEERS; i++)
+  {
+    uint8_t mac[6];
+    for (uint8_t j = 0; j < 6; j++)
+    {
+      state ^= state << 13; // xorshift32
+      state ^= state >> 17;
+      state ^= state << 5;
+      mac[j] = (uint8_t)state;
+    }
+    g_benchAddresses[i] = MacKey(mac);
+  }
+}
+
+/**
+ * @brief throw away whatever the code being measured logged, so every iteration pushes into an empty ring
+ *
+ */
+static void emptyBenchLog()
+{
+  while (gamedock::g_log.peek() != NULL)
+  {
+    gamedock::g_log.pop();
+  }
+}
+
+/**
+ * @brief time one benchmark at one peer count
+ *
+ * @param reset puts the state back before every iteration, timed on its own and taken off
+ * @param body the code being measured, making calls calls per iteration
+ */
+template <typename RESET, typename BODY>
+static double benchmark(uint16_t iterations, uint16_t calls, RESET reset, BODY body)
+{
+  uint32_t fastestReset = UINT32_MAX, fastestTotal = UINT32_MAX;
+  for (int8_t batch = -1; batch < BENCH_BATCHES; batch++) // Batch -1 is the warm-up
+  {
+    uint32_t start = benchNow();
+    for (uint16_t i = 0; i < iterations; i++)
+    {
+      reset();
+      emptyBenchLog();
+      BENCH_BARRIER();
+    }
+    uint32_t resetOnly = benchNow() - start;
+    start = benchNow();
+    for (uint16_t i = 0; i < iterations; i++)
+    {
+      reset();
+      emptyBenchLog();
+      body();
+    }
+    uint32_t total = benchNow() - start;
+    if (batch >= 0)
+    {
+      fastestReset = min(fastestReset, resetOnly);
+      fastestTotal = min(fastestTotal, total);
+    }
+    yield(); // Keep the watchdog fed between batches
+  }
+  return max((double)fastestTotal - fastestReset, 0.0) / iterations / calls;
+}
+
+/**
+ * @brief fill g_peers with the first peers bench addresses, as sync would leave it
+ *
+ */
+static void loadBenchPeers(uint8_t peers)
+{
+  gamedock::g_peers.clear();
+  for (uint8_t i = 0; i < peers; i++)
+  {
+    gamedock::g_peers.insertSorted(g_benchAddresses[i]);
+  }
+}
+
+/**
+ * @brief run every benchmark at every peer count
+ *
+ * @param iterations how many iterations are in each batch
+ */
+static void runBenchmarks(uint16_t iterations, bench_report report)
+{
+  using namespace gamedock;
+  makeBenchAddresses();
+  g_catchingUp = false;                  // Nothing is sent while merging lists
+  g_linkPeers.insert(BROADCAST_ADDRESS); // Still syncing, so new peers aren't registered with esp now
+
+  for (uint8_t peers : BENCH_PEERS)
+  {
+    report("checkAndSyncAddress", peers, benchmark(iterations, peers, [] { g_peers.clear(); }, [peers] {
+             for (uint8_t i = 0; i < peers; i++)
+             {
+               checkAndSyncAddress(g_benchAddresses[i]);
+             }
+           }));
+
+    report("PeerTable::insertSorted", peers, benchmark(iterations, peers * BENCH_ROUNDS, [] {}, [peers] {
+             for (uint8_t round = 0; round < BENCH_ROUNDS; round++)
+             {
+               g_peers.clear(); // Just zeroes the count
+               for (uint8_t i = 0; i < peers; i++)
+               {
+                 g_peers.insertSorted(g_benchAddresses[i]);
+               }
+             }
+           }));
+
+    autosync_packet list = {};
+    list.peerListMsg.count = peers;
+    for (uint8_t i = 0; i < peers; i++)
+    {
+      list.peerListMsg.peers[i] = g_benchAddresses[i];
+    }
+    report("confirmPeerList(new)", peers, benchmark(iterations, 1, [] { g_peers.clear(); }, [&list] {
+             confirmPeerList(DUMMY_ADDRESS, list.peerListMsg, false);
+           }));
+    report("confirmPeerList(known)", peers, benchmark(iterations, 1, [peers] { loadBenchPeers(peers); }, [&list] {
+             confirmPeerList(DUMMY_ADDRESS, list.peerListMsg, false);
+           }));
+
+    loadBenchPeers(peers);
+    g_loopPhase = PHASE_ORDER; // Turn orders are only registered once order selection starts
+    report("registerTurnOrder", peers, benchmark(iterations, peers - 1, [peers] {
+             g_syncedPeers = peers;
+             g_turnOrderChosen = 0; }, [peers] {
+             for (uint8_t i = 0; i + 1 < peers; i++) // The last one is assigned by the one before it
+             {
+               registerTurnOrder(g_benchAddresses[i]);
+             }
+           }));
+    g_loopPhase = PHASE_SYNC;
+
+    report("setNextPlayer", peers, benchmark(iterations, peers * BENCH_ROUNDS, [] {}, [peers] {
+             uint32_t sum = 0;
+             for (uint16_t i = 0; i < peers * BENCH_ROUNDS; i++)
+             {
+               g_currentPlayer = g_benchAddresses[i % peers];
+               sum += setNextPlayer();
+             }
+             g_benchSink = sum;
+           }));
+
+    report("PeerTable::digest", peers, benchmark(iterations, BENCH_ROUNDS, [] {}, [] {
+             for (uint8_t i = 0; i < BENCH_ROUNDS; i++)
+             {
+               g_benchSink = g_peers.digest();
+               BENCH_BARRIER();
+             }
+           }));
+
+    uint8_t first[6], second[6];
+    g_benchAddresses[0].toBytes(first);
+    g_benchAddresses[peers - 1].toBytes(second);
+    report("MacKey::fromBytes", peers, benchmark(iterations, peers * BENCH_ROUNDS, [] {}, [peers, &first, &second] {
+             uint32_t equal = 0;
+             for (uint16_t i = 0; i < peers * BENCH_ROUNDS; i++) // As the callbacks do with the sender's mac
+             {
+               equal += MacKey::fromBytes(i % 2 ? first : second) == g_benchAddresses[0];
+               BENCH_BARRIER();
+             }
+             g_benchSink = equal;
+           }));
+    report("MacKey::toBytes", peers, benchmark(iterations, peers * BENCH_ROUNDS, [] {}, [peers, &first] {
+             for (uint16_t i = 0; i < peers * BENCH_ROUNDS; i++) // As sending to a peer and the log do
+             {
+               g_benchAddresses[i % peers].toBytes(first);
+               BENCH_BARRIER();
+             }
+             g_benchSink = first[5];
+           }));
+  }
+}
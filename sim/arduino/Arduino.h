@@ -0,0 +1,123 @@
+#pragma once
+
+/**
+ * @brief host stand-in for the parts of the ESP8266 Arduino core the firmware uses
+ *
+ * Everything here is implemented by sim.cpp against whichever virtual dock is running at the moment, so millis(),
+ * digitalRead(), random() and Serial all answer for that dock alone. Only what src/ actually calls is declared;
+ * a new core call in the firmware shows up as a link error in the simulator build rather than silently doing nothing.
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+
+#define CHANGE 3
+#define FALLING 2
+#define RISING 1
+
+#define DEC 10
+#define HEX 16
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+/**
+ * @brief the UART, one per virtual dock, collected a line at a time
+ *
+ */
+class HardwareSerial
+{
+public:
+  void begin(unsigned long baud);
+  int availableForWrite();
+  int available();
+  int read();
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+
+  size_t print(const char *text);
+  size_t print(char c);
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(long long value, int base = DEC);
+  size_t print(unsigned long long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println();
+  template <typename T>
+  size_t println(T value)
+  {
+    size_t written = print(value);
+    return written + println();
+  }
+  template <typename T>
+  size_t println(T value, int format)
+  {
+    size_t written = print(value, format);
+    return written + println();
+  }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+/**
+ * @brief the chip itself
+ *
+ */
+class EspClass
+{
+public:
+  void restart();
+  uint32_t getCycleCount();
+  uint8_t getCpuFreqMHz();
+  uint32_t getFreeHeap();
+  uint32_t random();
+};
+
+extern EspClass ESP;
+
+/**
+ * @brief the hardware random number generator register, per dock and seeded from the simulation seed
+ *
+ */
+#define RANDOM_REG32 (ESP.random())
@@ -0,0 +1,23 @@
+#pragma once
+
+/**
+ * @brief host stand-in for the ESP8266 WiFi class: each virtual dock gets its own station mac address
+ *
+ */
+
+#include <Arduino.h>
+
+#define WIFI_OFF 0
+#define WIFI_STA 1
+#define WIFI_AP 2
+#define WIFI_AP_STA 3
+
+class ESP8266WiFiClass
+{
+public:
+  uint8_t *macAddress(uint8_t *mac);
+  bool mode(uint8_t mode);
+  bool disconnect(bool wifiOff = false);
+};
+
+extern ESP8266WiFiClass WiFi;
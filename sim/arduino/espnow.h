@@ -0,0 +1,34 @@
+#pragma once
+
+/**
+ * @brief host stand-in for the ESP8266 esp now API, backed by the simulated radio channel in sim.cpp
+ *
+ * Same signatures and return conventions as the SDK: 0 for success, non-zero for failure, and a send status of 0
+ * for delivered or 1 for not acknowledged.
+ *
+ */
+
+#include <stdint.h>
+
+enum esp_now_role
+{
+  ESP_NOW_ROLE_IDLE = 0,
+  ESP_NOW_ROLE_CONTROLLER,
+  ESP_NOW_ROLE_SLAVE,
+  ESP_NOW_ROLE_COMBO,
+  ESP_NOW_ROLE_MAX,
+};
+
+typedef void (*esp_now_recv_cb_t)(uint8_t *mac, uint8_t *data, uint8_t len);
+typedef void (*esp_now_send_cb_t)(uint8_t *mac, uint8_t status);
+
+int esp_now_init(void);
+int esp_now_deinit(void);
+int esp_now_set_self_role(uint8_t role);
+int esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+int esp_now_unregister_recv_cb(void);
+int esp_now_register_send_cb(esp_now_send_cb_t cb);
+int esp_now_unregister_send_cb(void);
+int esp_now_add_peer(uint8_t *mac_addr, uint8_t role, uint8_t channel, uint8_t *key, uint8_t key_len);
+int esp_now_del_peer(uint8_t *mac_addr);
+int esp_now_send(uint8_t *da, uint8_t *data, int len);
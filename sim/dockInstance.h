@@ -0,0 +1,56 @@
+/**
+ * @brief one copy of the firmware in the namespace named by SIM_DOCK, included once per dock by docks.cpp
+ *
+ * Deliberately not #pragma once. Every header main.cpp includes has already been included at global scope,
+ * so their include guards skip them here and only main.cpp's own globals and functions are duplicated.
+ *
+ */
+
+namespace SIM_DOCK
+{
+#include "../src/main.cpp"
+
+const sim_dock_api SIM_API = {
+    setup,
+    loop,
+    [](sim_tuning &tuning) {
+      tuneValue(SYNC_BEACON_START_MS, tuning.beaconStartMs);
+      tuneValue(SYNC_BEACON_MIN_MS, tuning.beaconMinMs);
+      tuneValue(SYNC_BEACON_MAX_MS, tuning.beaconMaxMs);
+      tuneValue(SYNC_BEACON_MS_PER_PEER, tuning.beaconPerPeerMs);
+      tuneValue(CATCH_UP_MS, tuning.catchUpMs);
+      tuneValue(RESTART_HOLD_MS, tuning.restartHoldMs);
+      tuneValue(TX_BACKOFF_BASE_MS, tuning.txBackoffMs);
+      tuneValue(TX_RESULT_TIMEOUT_MS, tuning.txResultTimeoutMs);
+      tuneValue(TX_BATCH_WINDOW_MS, tuning.txBatchWindowMs);
+      g_beaconIntervalMs = SYNC_BEACON_START_MS;
+    },
+    {SYNC_BUTTON, PREV_BUTTON, NEXT_BUTTON, FLASH_BUTTON},
+    []() -> uint8_t { return g_peers.count(); },
+    []() -> uint32_t { return g_peers.digest(); },
+    []() -> uint64_t { return g_currentPlayer.value; },
+    []() -> uint64_t { return g_firstPlayer.value; },
+    []() -> uint8_t { return turnOrderCount(); },
+    []() -> sim_phase {
+      if (g_buttonHandler == takeTurnsButtonHandler)
+      {
+        return SIM_PHASE_TURNS;
+      }
+      if (g_buttonHandler == orderSelectionButtonHandler)
+      {
+        return SIM_PHASE_ORDER;
+      }
+      if (g_catchingUp)
+      {
+        return SIM_PHASE_CATCH_UP;
+      }
+      if (g_buttonHandler == syncButtonHandler)
+      {
+        return SIM_PHASE_SYNC;
+      }
+      return g_ownPeerListConfirmed ? SIM_PHASE_CHOSEN : SIM_PHASE_OTHER;
+    },
+};
+} // namespace SIM_DOCK
+
+#undef SIM_DOCK
@@ -0,0 +1,102 @@
+/**
+ * @brief SIM_MAX_DOCKS copies of the firmware, each in its own namespace so every dock has its own globals
+ *
+ * The firmware keeps all of its state in globals, so instead of changing it to run more than once per process,
+ * main.cpp is compiled once per dock. Every header it includes comes first, at global scope, so the shared types
+ * (MacKey, PeerTable, Scheduler, ...) are the same type in every dock and the Arduino stand-ins are shared too.
+ *
+ */
+
+#define GAMEDOCK_SIM // The firmware's TUNABLE constants become variables
+
+#include "sim.h"
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#include <vector>
+#include "logRing.h"
+#include "scheduler.h"
+#include "buttons.h"
+#include "macKey.h"
+#include "seqWindow.h"
+#include "peerTable.h"
+#include "bloomFilter.h"
+#include "timingStats.h"
+#include "linkStats.h"
+#include "traceBuffer.h"
+
+/**
+ * @brief override a TUNABLE if the override is set, and report the value in use either way
+ *
+ */
+static void tuneValue(uint32_t &constant, uint32_t &value)
+{
+  if (value != SIM_TUNING_UNSET)
+  {
+    constant = value;
+  }
+  value = constant;
+}
+
+#define SIM_DOCK dock0
+#include "dockInstance.h"
+#define SIM_DOCK dock1
+#include "dockInstance.h"
+#define SIM_DOCK dock2
+#include "dockInstance.h"
+#define SIM_DOCK dock3
+#include "dockInstance.h"
+#define SIM_DOCK dock4
+#include "dockInstance.h"
+#define SIM_DOCK dock5
+#include "dockInstance.h"
+#define SIM_DOCK dock6
+#include "dockInstance.h"
+#define SIM_DOCK dock7
+#include "dockInstance.h"
+#define SIM_DOCK dock8
+#include "dockInstance.h"
+#define SIM_DOCK dock9
+#include "dockInstance.h"
+#define SIM_DOCK dock10
+#include "dockInstance.h"
+#define SIM_DOCK dock11
+#include "dockInstance.h"
+#define SIM_DOCK dock12
+#include "dockInstance.h"
+#define SIM_DOCK dock13
+#include "dockInstance.h"
+#define SIM_DOCK dock14
+#include "dockInstance.h"
+#define SIM_DOCK dock15
+#include "dockInstance.h"
+#define SIM_DOCK dock16
+#include "dockInstance.h"
+#define SIM_DOCK dock17
+#include "dockInstance.h"
+#define SIM_DOCK dock18
+#include "dockInstance.h"
+#define SIM_DOCK dock19
+#include "dockInstance.h"
+
+const sim_dock_api SIM_DOCKS[SIM_MAX_DOCKS] = {
+    dock0::SIM_API,
+    dock1::SIM_API,
+    dock2::SIM_API,
+    dock3::SIM_API,
+    dock4::SIM_API,
+    dock5::SIM_API,
+    dock6::SIM_API,
+    dock7::SIM_API,
+    dock8::SIM_API,
+    dock9::SIM_API,
+    dock10::SIM_API,
+    dock11::SIM_API,
+    dock12::SIM_API,
+    dock13::SIM_API,
+    dock14::SIM_API,
+    dock15::SIM_API,
+    dock16::SIM_API,
+    dock17::SIM_API,
+    dock18::SIM_API,
+    dock19::SIM_API,
+};
@@ -0,0 +1,138 @@
+#include "options.h"
+#include <stdio.h>
+
+#define CONFIG_PARAMETER(name, column, help, listed, field)                                         \
+  {                                                                                                 \
+    name, column, help, listed,                                                                     \
+        [](sim_config &config, scenario_options &, double value) { config.field = value; },          \
+        [](const sim_config &config, const scenario_options &) -> double { return config.field; } \
+  }
+
+#define OPTIONS_PARAMETER(name, column, help, field)                                                  \
+  {                                                                                                   \
+    name, column, help, false,                                                                        \
+        [](sim_config &, scenario_options &options, double value) { options.field = value; },          \
+        [](const sim_config &, const scenario_options &options) -> double { return options.field; } \
+  }
+
+const sim_parameter SIM_PARAMETERS[] = {
+    CONFIG_PARAMETER("docks", "docks", "docks on the channel, 1 to 20", true, docks),
+    CONFIG_PARAMETER("seed", "seed", "seed for every random choice", false, seed),
+    CONFIG_PARAMETER("loss", "loss", "chance a receiver misses a frame, 0 to 1", true, loss),
+    CONFIG_PARAMETER("latency", "latency_us", "delay from end of frame to receive callback, us", false, latencyUs),
+    CONFIG_PARAMETER("jitter", "jitter_us", "extra random receive delay, us", false, latencyJitterUs),
+    CONFIG_PARAMETER("slots", "slots", "contention window in slots", false, contentionSlots),
+    CONFIG_PARAMETER("mac-retries", "mac_retries", "unicast retransmits before a failed send", false, macRetries),
+    CONFIG_PARAMETER("bounce", "bounce", "contact bounces per button edge", false, bounceEdges),
+    OPTIONS_PARAMETER("hold", "hold_ms", "how long sync is held, ms", holdMs),
+    OPTIONS_PARAMETER("press-jitter", "press_jitter_ms", "spread of everyone's presses, ms", pressJitterMs),
+    OPTIONS_PARAMETER("choose-gap", "choose_gap_ms", "time between players choosing their order, ms", chooseGapMs),
+    OPTIONS_PARAMETER("turns", "turns", "turn passes to time", turns),
+    OPTIONS_PARAMETER("turn-gap", "turn_gap_ms", "pause between turn passes, ms", turnGapMs),
+    OPTIONS_PARAMETER("timeout", "timeout_ms", "give up after this much simulated time, ms", timeoutMs),
+    CONFIG_PARAMETER("beacon-ms", "beacon_ms", "SYNC_BEACON_START_MS", true, tuning.beaconStartMs),
+    CONFIG_PARAMETER("beacon-min-ms", "beacon_min_ms", "SYNC_BEACON_MIN_MS", true, tuning.beaconMinMs),
+    CONFIG_PARAMETER("beacon-max-ms", "beacon_max_ms", "SYNC_BEACON_MAX_MS", true, tuning.beaconMaxMs),
+    CONFIG_PARAMETER("beacon-per-peer-ms", "beacon_per_peer_ms", "SYNC_BEACON_MS_PER_PEER", true, tuning.beaconPerPeerMs),
+    CONFIG_PARAMETER("catch-up-ms", "catch_up_ms", "CATCH_UP_MS", true, tuning.catchUpMs),
+    CONFIG_PARAMETER("restart-hold-ms", "restart_hold_ms", "RESTART_HOLD_MS", true, tuning.restartHoldMs),
+    CONFIG_PARAMETER("backoff-ms", "backoff_ms", "TX_BACKOFF_BASE_MS", true, tuning.txBackoffMs),
+    CONFIG_PARAMETER("result-timeout-ms", "result_timeout_ms", "TX_RESULT_TIMEOUT_MS", true, tuning.txResultTimeoutMs),
+    CONFIG_PARAMETER("batch-window-ms", "batch_window_ms", "TX_BATCH_WINDOW_MS", true, tuning.txBatchWindowMs),
+};
+
+const uint8_t SIM_PARAMETER_COUNT = sizeof(SIM_PARAMETERS) / sizeof(SIM_PARAMETERS[0]);
+
+/**
+ * @brief parse a comma separated list of numbers
+ *
+ */
+static boolean parseList(const char *text, std::vector<double> &values)
+{
+  while (*text)
+  {
+    char *end;
+    values.push_back(strtod(text, &end));
+    if (end == text || (*end != ',' && *end != '\0'))
+    {
+      return false;
+    }
+    text = *end == ',' ? end + 1 : end;
+  }
+  return !values.empty();
+}
+
+boolean parseArguments(int argc, char **argv, sim_config &config, scenario_options &options,
+                       std::vector<std::vector<double>> *sweep)
+{
+  if (sweep)
+  {
+    sweep->assign(SIM_PARAMETER_COUNT, std::vector<double>());
+  }
+  for (int i = 1; i < argc; i++)
+  {
+    const char *option = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(option, "--no-collisions") == 0)
+    {
+      config.collisions = false;
+      continue;
+    }
+    if (strcmp(option, "--verbose") == 0)
+    {
+      config.verbose = true;
+      continue;
+    }
+    if (strcmp(option, "--trace") == 0 && value && sweep == NULL) // Every session would write the same file
+    {
+      i++;
+      options.tracePath = value;
+      continue;
+    }
+    if (strcmp(option, "--script") == 0 && value)
+    {
+      i++;
+      if (!loadScript(value, options.script))
+      {
+        return false;
+      }
+      continue;
+    }
+    uint8_t parameter = 0;
+    while (parameter < SIM_PARAMETER_COUNT &&
+           (strncmp(option, "--", 2) != 0 || strcmp(option + 2, SIM_PARAMETERS[parameter].option) != 0))
+    {
+      parameter++;
+    }
+    std::vector<double> values;
+    if (parameter == SIM_PARAMETER_COUNT || value == NULL || !parseList(value, values) ||
+        (sweep == NULL && values.size() > 1))
+    {
+      fprintf(stderr, "sim: bad option %s%s%s\n", option, value ? " " : "", value ? value : "");
+      return false;
+    }
+    i++;
+    SIM_PARAMETERS[parameter].apply(config, options, values[0]);
+    if (sweep)
+    {
+      (*sweep)[parameter] = values;
+    }
+  }
+  config.docks = constrain(config.docks, 1, SIM_MAX_DOCKS);
+  config.contentionSlots = max(config.contentionSlots, (uint8_t)1);
+  return true;
+}
+
+void printOptions()
+{
+  for (uint8_t i = 0; i < SIM_PARAMETER_COUNT; i++)
+  {
+    fprintf(stderr, "  --%-20s %s\n", SIM_PARAMETERS[i].option, SIM_PARAMETERS[i].help);
+  }
+  fprintf(stderr,
+          "  --%-20s frames never collide, only defer\n"
+          "  --%-20s play a button script instead of the built-in scenario\n"
+          "  --%-20s echo every dock's serial output to stderr\n"
+          "  --%-20s dump every dock's trace to FILE at the end, not in sweeps\n",
+          "no-collisions", "script FILE", "verbose", "trace FILE");
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "scenario.h"
+
+/**
+ * @brief a numeric command line option: the channel, the players or one of the firmware's TUNABLE constants
+ *
+ */
+typedef struct sim_parameter
+{
+  const char *option;  // on the command line, without the leading --
+  const char *column;  // in sweep CSV output
+  const char *help;
+  boolean listed;      // always a sweep CSV column, not just when it's swept
+  void (*apply)(sim_config &config, scenario_options &options, double value);
+  double (*read)(const sim_config &config, const scenario_options &options);
+} sim_parameter;
+
+extern const sim_parameter SIM_PARAMETERS[];
+extern const uint8_t SIM_PARAMETER_COUNT;
+
+/**
+ * @brief parse the command line into config and options
+ *
+ * With sweep set, every numeric option can be a comma separated list, and sweep gets one entry per parameter
+ * holding the values to try, empty for the ones that weren't given. Without it each option takes one value.
+ *
+ * @return false and a message on stderr if an option is unknown or its value doesn't parse
+ */
+boolean parseArguments(int argc, char **argv, sim_config &config, scenario_options &options,
+                       std::vector<std::vector<double>> *sweep);
+
+/**
+ * @brief the option list for --help
+ *
+ */
+void printOptions();
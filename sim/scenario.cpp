@@ -0,0 +1,351 @@
+#include "scenario.h"
+#include <stdio.h>
+
+static const char *BUTTON_NAMES[SIM_BUTTON_COUNT] = {"sync", "prev", "next", "flash"};
+static const char *ACTION_NAMES[] = {"press", "release", "tap"};
+
+/**
+ * @brief how often the harness checks on the docks, also the resolution of every time it measures
+ *
+ */
+static const uint32_t POLL_US = 1000;
+
+/**
+ * @brief how long every dock gets to print its trace at the end of a run, many times what a full buffer takes
+ *
+ */
+static const uint32_t TRACE_DUMP_US = 100000;
+
+boolean loadScript(const char *path, std::vector<script_step> &script)
+{
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    fprintf(stderr, "sim: can't open script %s\n", path);
+    return false;
+  }
+  char line[256];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), file))
+  {
+    lineNumber++;
+    char *comment = strchr(line, '#');
+    if (comment)
+    {
+      *comment = '\0';
+    }
+    char dock[16], button[16], action[16];
+    unsigned long timeMs, holdMs = 0;
+    int fields = sscanf(line, "%lu %15s %15s %15s %lu", &timeMs, dock, button, action, &holdMs);
+    if (fields <= 0)
+    {
+      continue; // Blank
+    }
+    script_step step = {};
+    step.timeMs = timeMs;
+    step.holdMs = holdMs;
+    step.dock = strcmp(dock, "all") == 0 ? -1 : atoi(dock);
+    step.button = SIM_BUTTON_COUNT;
+    for (uint8_t i = 0; i < SIM_BUTTON_COUNT; i++)
+    {
+      if (fields >= 3 && strcmp(button, BUTTON_NAMES[i]) == 0)
+      {
+        step.button = (sim_button)i;
+      }
+    }
+    step.action = 0xFF;
+    for (uint8_t i = 0; i < sizeof(ACTION_NAMES) / sizeof(ACTION_NAMES[0]); i++)
+    {
+      if (fields >= 4 && strcmp(action, ACTION_NAMES[i]) == 0)
+      {
+        step.action = i;
+      }
+    }
+    if (fields < 4 || step.button == SIM_BUTTON_COUNT || step.action == 0xFF || step.dock >= SIM_MAX_DOCKS)
+    {
+      fprintf(stderr, "sim: %s:%d: expected time_ms dock|all sync|prev|next|flash press|release|tap [hold_ms]\n",
+              path, lineNumber);
+      fclose(file);
+      return false;
+    }
+    script.push_back(step);
+  }
+  fclose(file);
+  return true;
+}
+
+/**
+ * @brief presses buttons for the players and watches every dock to time each stage of the game start
+ *
+ */
+class Harness
+{
+public:
+  Harness(Simulator &sim, const scenario_options &options) : m_sim(sim), m_options(options)
+  {
+  }
+
+  /**
+   * @brief press or release a button, remembering what the measurements need to know about it
+   *
+   */
+  void setButton(uint8_t dock, sim_button button, boolean down)
+  {
+    if (!m_sim.running(dock))
+    {
+      return;
+    }
+    if (button == SIM_BUTTON_SYNC && !down && m_sim.api(dock).phase() == SIM_PHASE_SYNC)
+    {
+      m_lastSyncReleaseUs = m_sim.now();
+      m_result.convergedMs = m_result.readyMs = m_result.turnsMs = -1; // A late release restarts the clock
+    }
+    boolean passing = button == SIM_BUTTON_NEXT || button == SIM_BUTTON_PREV;
+    if (down && passing && m_sim.api(dock).phase() == SIM_PHASE_TURNS && m_sim.mac(dock) == m_agreedPlayer &&
+        m_turnPressUs == 0)
+    {
+      m_turnPressUs = m_sim.now();
+    }
+    m_sim.setButton(dock, button, down);
+  }
+
+  void tap(uint8_t dock, sim_button button, uint32_t holdMs)
+  {
+    setButton(dock, button, true);
+    m_sim.at(m_sim.now() + holdMs * 1000ull, [this, dock, button]()
+             { setButton(dock, button, false); });
+  }
+
+  /**
+   * @brief queue every step of a script, spreading the steps for all docks by the press jitter
+   *
+   */
+  void playScript(const std::vector<script_step> &script)
+  {
+    for (const script_step &step : script)
+    {
+      for (uint8_t dock = 0; dock < m_sim.docks(); dock++)
+      {
+        if (step.dock >= 0 && step.dock != dock)
+        {
+          continue;
+        }
+        uint64_t jitterUs = step.dock < 0 ? m_sim.random(m_options.pressJitterMs * 1000 + 1) : 0;
+        uint32_t holdMs = step.holdMs ? step.holdMs : m_options.tapMs;
+        script_step copy = step;
+        m_sim.at(step.timeMs * 1000ull + jitterUs, [this, dock, copy, holdMs]()
+                 {
+                   if (copy.action == SCRIPT_TAP)
+                   {
+                     tap(dock, copy.button, holdMs);
+                   }
+                   else
+                   {
+                     setButton(dock, copy.button, copy.action == SCRIPT_PRESS);
+                   } });
+      }
+    }
+  }
+
+  /**
+   * @brief the built-in scenario's sync: everyone presses around startMs and lets go around startMs + holdMs
+   *
+   */
+  void playSync()
+  {
+    for (uint8_t dock = 0; dock < m_sim.docks(); dock++)
+    {
+      uint64_t pressUs = (m_options.startMs + m_sim.random(m_options.pressJitterMs + 1)) * 1000ull;
+      uint64_t releaseUs = (m_options.startMs + m_options.holdMs + m_sim.random(m_options.pressJitterMs + 1)) * 1000ull;
+      m_sim.at(pressUs, [this, dock]()
+               { setButton(dock, SIM_BUTTON_SYNC, true); });
+      m_sim.at(releaseUs, [this, dock]()
+               { setButton(dock, SIM_BUTTON_SYNC, false); });
+    }
+  }
+
+  /**
+   * @brief check on every dock, record anything that just happened, and, in the built-in scenario, play the next move
+   *
+   */
+  void poll(boolean scripted)
+  {
+    uint8_t docks = m_sim.docks();
+    double sinceRelease = (m_sim.now() - m_lastSyncReleaseUs) / 1000.0;
+    if (m_lastSyncReleaseUs == 0)
+    {
+      return;
+    }
+    boolean converged = true;
+    boolean ready = true;
+    boolean turns = true;
+    const sim_dock_api &first = m_sim.api(0);
+    for (uint8_t dock = 0; dock < docks; dock++)
+    {
+      const sim_dock_api &api = m_sim.api(dock);
+      sim_phase phase = api.phase();
+      converged = converged && api.peerCount() == docks && api.peerDigest() == first.peerDigest();
+      ready = ready && (phase == SIM_PHASE_ORDER || phase == SIM_PHASE_CHOSEN || phase == SIM_PHASE_TURNS) &&
+              api.firstPlayer() == first.firstPlayer();
+      turns = turns && phase == SIM_PHASE_TURNS && api.currentPlayer() == first.currentPlayer();
+    }
+    if (converged && m_result.convergedMs < 0)
+    {
+      m_result.convergedMs = sinceRelease;
+    }
+    if (ready && m_result.readyMs < 0)
+    {
+      m_result.readyMs = sinceRelease;
+    }
+    if (turns && m_result.turnsMs < 0)
+    {
+      m_result.turnsMs = sinceRelease;
+      m_agreedPlayer = first.currentPlayer();
+      m_lastAgreedUs = m_sim.now();
+    }
+    if (turns && first.currentPlayer() != m_agreedPlayer) // Everyone sees the pass
+    {
+      if (m_turnPressUs)
+      {
+        m_result.turnLatencyMs.push_back((m_sim.now() - m_turnPressUs) / 1000.0);
+      }
+      m_turnPressUs = 0;
+      m_agreedPlayer = first.currentPlayer();
+      m_lastAgreedUs = m_sim.now();
+    }
+    if (scripted)
+    {
+      return;
+    }
+    if (ready && m_result.turnsMs < 0)
+    {
+      chooseNext();
+    }
+    else if (turns && m_turnPressUs == 0 && m_result.turnLatencyMs.size() < m_options.turns &&
+             m_sim.now() - m_lastAgreedUs >= m_options.turnGapMs * 1000ull)
+    {
+      int player = m_sim.dockWithMac(m_agreedPlayer);
+      if (player >= 0)
+      {
+        tap(player, SIM_BUTTON_NEXT, m_options.tapMs);
+      }
+    }
+  }
+
+  /**
+   * @brief whether the built-in scenario has nothing left to do
+   *
+   */
+  boolean done() const
+  {
+    return m_result.turnsMs >= 0 && m_result.turnLatencyMs.size() >= m_options.turns;
+  }
+
+  scenario_result &result()
+  {
+    return m_result;
+  }
+
+private:
+  /**
+   * @brief one player at a time, chooseGapMs apart, picks their place in the turn order
+   *
+   */
+  void chooseNext()
+  {
+    if (m_lastChoiceUs && m_sim.now() - m_lastChoiceUs < m_options.chooseGapMs * 1000ull)
+    {
+      return;
+    }
+    std::vector<uint8_t> waiting;
+    for (uint8_t dock = 0; dock < m_sim.docks(); dock++)
+    {
+      if (m_sim.api(dock).phase() == SIM_PHASE_ORDER && m_sim.mac(dock) != m_sim.api(dock).firstPlayer())
+      {
+        waiting.push_back(dock);
+      }
+    }
+    if (waiting.empty())
+    {
+      return;
+    }
+    m_lastChoiceUs = m_sim.now();
+    tap(waiting[m_sim.random(waiting.size())], SIM_BUTTON_NEXT, m_options.tapMs);
+  }
+
+  Simulator &m_sim;
+  const scenario_options &m_options;
+  scenario_result m_result;
+  uint64_t m_lastSyncReleaseUs = 0;
+  uint64_t m_lastChoiceUs = 0;
+  uint64_t m_agreedPlayer = 0;
+  uint64_t m_lastAgreedUs = 0;
+  uint64_t m_turnPressUs = 0;
+};
+
+/**
+ * @brief type trace into every dock that's still running and write what they print to a file
+ *
+ * Each line is prefixed with the dock it came from, the same way --verbose prints them.
+ *
+ */
+static void dumpTraces(Simulator &sim, const std::string &path)
+{
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == NULL)
+  {
+    fprintf(stderr, "sim: can't write trace %s\n", path.c_str());
+    return;
+  }
+  sim.onSerialLine([&sim, file](uint8_t dock, const std::string &line)
+                   {
+                     if (line.compare(0, 5, "trace") == 0)
+                     {
+                       fprintf(file, "%10.3f dock%02u | %s\n", sim.now() / 1000.0, dock, line.c_str());
+                     } });
+  for (uint8_t dock = 0; dock < sim.docks(); dock++)
+  {
+    if (sim.running(dock))
+    {
+      sim.serialInput(dock, "trace\n");
+    }
+  }
+  sim.runUntil(sim.now() + TRACE_DUMP_US);
+  sim.onSerialLine(NULL);
+  fclose(file);
+}
+
+scenario_result runScenario(const sim_config &config, const scenario_options &options)
+{
+  Simulator sim(config);
+  Harness harness(sim, options);
+  boolean scripted = !options.script.empty();
+  sim.start();
+  if (scripted)
+  {
+    harness.playScript(options.script);
+  }
+  else
+  {
+    harness.playSync();
+  }
+  uint64_t timeoutUs = options.timeoutMs * 1000ull;
+  while (sim.now() < timeoutUs && !(!scripted && harness.done()))
+  {
+    sim.runUntil(sim.now() + POLL_US);
+    harness.poll(scripted);
+  }
+  if (!options.tracePath.empty())
+  {
+    dumpTraces(sim, options.tracePath);
+  }
+  scenario_result &result = harness.result();
+  for (uint8_t dock = 0; dock < sim.docks(); dock++)
+  {
+    result.restarts += !sim.running(dock);
+  }
+  result.finished = (scripted || harness.done()) && result.restarts == 0;
+  result.stats = sim.stats();
+  result.endMs = sim.now() / 1000.0;
+  return result;
+}
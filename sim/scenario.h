@@ -0,0 +1,76 @@
+#pragma once
+
+#include "sim.h"
+
+/**
+ * @brief one line of a button script: at a time, one dock or all of them press, release or tap a button
+ *
+ */
+typedef struct script_step
+{
+  uint32_t timeMs;
+  int dock; // -1 for every dock, each with its own jitter
+  sim_button button;
+  uint8_t action; // SCRIPT_PRESS, SCRIPT_RELEASE or SCRIPT_TAP
+  uint32_t holdMs; // how long a tap holds the button down
+} script_step;
+
+static const uint8_t SCRIPT_PRESS = 0;
+static const uint8_t SCRIPT_RELEASE = 1;
+static const uint8_t SCRIPT_TAP = 2;
+
+/**
+ * @brief what the players do, on top of the channel in sim_config
+ *
+ * With no script, the built-in scenario plays a whole game start: every dock's sync button is pressed around
+ * startMs and held for about holdMs, each player picks their place in the order chooseGapMs apart, then the turn is
+ * passed turns times, turnGapMs after everyone has seen the last pass.
+ *
+ */
+typedef struct scenario_options
+{
+  std::vector<script_step> script; // replaces the built-in scenario when not empty
+  uint32_t startMs = 1000;
+  uint32_t holdMs = 2000;
+  uint32_t pressJitterMs = 300; // people don't press or release at the same moment
+  uint32_t chooseGapMs = 400;
+  uint32_t turns = 5;
+  uint32_t turnGapMs = 500;
+  uint32_t tapMs = 100;
+  uint32_t timeoutMs = 60000;
+  std::string tracePath; // when set, every dock's trace is dumped here at the end, see tools/traceToChrome.py
+} scenario_options;
+
+/**
+ * @brief how a run went, in milliseconds of simulated time; a negative time means it never happened
+ *
+ * convergedMs and readyMs are counted from the last sync release, turn latencies from the press of next or prev
+ * to the moment every dock shows the new current player, debounce included.
+ *
+ */
+typedef struct scenario_result
+{
+  double convergedMs = -1; // every dock has the same digest over all N docks
+  double readyMs = -1;     // every dock has moved on to choosing the turn order, agreeing on the first player
+  double turnsMs = -1;     // every dock is taking turns
+  std::vector<double> turnLatencyMs;
+  boolean finished = false; // the built-in scenario got through every turn, or the script ran to its timeout, with no restarts
+  uint8_t restarts = 0;     // docks that restarted and stayed off
+  sim_stats stats;
+  double endMs = 0;
+} scenario_result;
+
+/**
+ * @brief read a button script, one step per line: time_ms dock|all sync|prev|next|flash press|release|tap [hold_ms]
+ *
+ * Blank lines and anything after # are ignored.
+ *
+ * @return false and a message on stderr if a line doesn't parse
+ */
+boolean loadScript(const char *path, std::vector<script_step> &script);
+
+/**
+ * @brief run one simulation from power on until the scenario finishes or times out
+ *
+ */
+scenario_result runScenario(const sim_config &config, const scenario_options &options);
@@ -0,0 +1,864 @@
+#include "sim.h"
+#include <ESP8266WiFi.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+Simulator *g_sim = NULL;
+
+/**
+ * @brief 802.11b timing at 1 Mbps with the long preamble, which is what esp now uses by default
+ *
+ */
+static const uint32_t SLOT_US = 20;
+static const uint32_t SIFS_US = 10;
+static const uint32_t DIFS_US = SIFS_US + 2 * SLOT_US;
+static const uint32_t PREAMBLE_US = 192;
+static const uint32_t US_PER_BYTE = 8;
+static const uint8_t FRAME_OVERHEAD_BYTES = 43; // MAC header, vendor action header, esp now element and FCS
+static const uint32_t ACK_US = PREAMBLE_US + 14 * US_PER_BYTE;
+
+/**
+ * @brief the number of esp now peers the SDK can hold at once, unencrypted
+ *
+ */
+static const uint8_t ESP_NOW_MAX_PEERS = 20;
+
+/**
+ * @brief the first three bytes of the docks' mac addresses, so the lowest address isn't always the first dock
+ *
+ */
+static const uint8_t ESPRESSIF_OUIS[][3] = {{0x5C, 0xCF, 0x7F}, {0x84, 0xF3, 0xEB}, {0x40, 0x91, 0x51}, {0xAC, 0x0B, 0xFB}};
+
+static uint64_t splitMix(uint64_t &state)
+{
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static uint64_t packMac(const uint8_t *mac)
+{
+  uint64_t packed = 0;
+  for (int i = 0; i < 6; i++)
+  {
+    packed = packed << 8 | mac[i];
+  }
+  return packed;
+}
+
+static boolean isBroadcast(const uint8_t *mac)
+{
+  return packMac(mac) == 0xFFFFFFFFFFFFull;
+}
+
+/********************************************************************************************************************************************
+ *                           Simulator
+ ********************************************************************************************************************************************/
+
+Simulator::Simulator(const sim_config &config) : m_config(config), m_rng(config.seed)
+{
+  g_sim = this;
+  if (m_config.docks > SIM_MAX_DOCKS)
+  {
+    m_config.docks = SIM_MAX_DOCKS;
+  }
+  for (uint8_t i = 0; i < SIM_MAX_DOCKS; i++)
+  {
+    memset(m_docks[i].mac, 0, 6);
+  }
+  for (uint8_t i = 0; i < SIM_MAX_DOCKS; i++)
+  {
+    sim_dock &dock = m_docks[i];
+    dock.index = i;
+    dock.running = false;
+    dock.clockOffsetUs = 0;
+    dock.rng = nextRandom();
+    dock.hwRng = nextRandom();
+    memset(dock.pinModes, INPUT, sizeof(dock.pinModes));
+    memset(dock.pinLevels, LOW, sizeof(dock.pinLevels));
+    memset(dock.isrs, 0, sizeof(dock.isrs));
+    dock.recvCallback = NULL;
+    dock.sendCallback = NULL;
+    do // Random addresses, but never the same one twice
+    {
+      const uint8_t *oui = ESPRESSIF_OUIS[random(sizeof(ESPRESSIF_OUIS) / sizeof(ESPRESSIF_OUIS[0]))];
+      uint32_t low = random(1 << 24);
+      uint8_t mac[6] = {oui[0], oui[1], oui[2], (uint8_t)(low >> 16), (uint8_t)(low >> 8), (uint8_t)low};
+      memcpy(dock.mac, mac, 6);
+    } while (dockWithMac(packMac(dock.mac)) != i);
+  }
+}
+
+void Simulator::start()
+{
+  for (uint8_t i = 0; i < m_config.docks; i++)
+  {
+    sim_event boot = {};
+    boot.time = m_now + (m_config.bootSpreadUs ? random(m_config.bootSpreadUs) : 0);
+    boot.type = SIM_EVENT_BOOT;
+    boot.dock = i;
+    schedule(boot);
+  }
+}
+
+void Simulator::runUntil(uint64_t timeUs)
+{
+  while (!m_events.empty() && m_events.top().time <= timeUs)
+  {
+    sim_event event = m_events.top();
+    m_events.pop();
+    m_now = event.time;
+    sim_dock &dock = m_docks[event.dock];
+    switch (event.type)
+    {
+    case SIM_EVENT_BOOT:
+      dock.running = true;
+      dock.clockOffsetUs = -(int64_t)m_now; // millis() starts at zero when the dock powers on
+      enter(event.dock);
+      SIM_DOCKS[event.dock].tune(m_config.tuning);
+      SIM_DOCKS[event.dock].setup();
+      leave();
+      event.type = SIM_EVENT_LOOP;
+      event.time = m_now + m_config.loopPeriodUs;
+      schedule(event);
+      break;
+    case SIM_EVENT_LOOP:
+      if (dock.running)
+      {
+        enter(event.dock);
+        SIM_DOCKS[event.dock].loop();
+        leave();
+        event.time = m_now + m_config.loopPeriodUs;
+        schedule(event);
+      }
+      break;
+    case SIM_EVENT_CONTEND:
+      startTransmit(event.dock);
+      break;
+    case SIM_EVENT_TX_END:
+      endTransmit(event.frame);
+      break;
+    case SIM_EVENT_RECEIVE:
+      if (dock.running && dock.recvCallback)
+      {
+        uint8_t from[6];
+        memcpy(from, m_docks[event.frame->from].mac, 6);
+        m_stats.deliveries++;
+        enter(event.dock);
+        dock.recvCallback(from, event.frame->data, event.frame->length);
+        leave();
+      }
+      break;
+    case SIM_EVENT_SENT:
+      if (dock.running && dock.sendCallback)
+      {
+        enter(event.dock);
+        dock.sendCallback(event.frame->dest, event.status);
+        leave();
+      }
+      break;
+    case SIM_EVENT_PIN:
+      setPin(event.dock, event.pin, event.level);
+      break;
+    case SIM_EVENT_ACTION:
+      event.action();
+      break;
+    }
+  }
+  m_now = max(m_now, timeUs);
+}
+
+void Simulator::at(uint64_t timeUs, std::function<void()> action)
+{
+  sim_event event = {};
+  event.time = max(timeUs, m_now);
+  event.type = SIM_EVENT_ACTION;
+  event.action = action;
+  schedule(event);
+}
+
+void Simulator::setButton(uint8_t dock, sim_button button, boolean down)
+{
+  uint8_t pin = SIM_DOCKS[dock].buttonPins[button];
+  boolean pullUp = m_docks[dock].pinModes[pin] == INPUT_PULLUP;
+  uint8_t level = down != pullUp ? HIGH : LOW;
+  uint64_t time = m_now;
+  for (uint8_t i = 0; i < 2 * m_config.bounceEdges; i++) // Chatter back and forth before settling
+  {
+    sim_event edge = {};
+    edge.time = time;
+    edge.type = SIM_EVENT_PIN;
+    edge.dock = dock;
+    edge.pin = pin;
+    edge.level = i % 2 == 0 ? level : !level;
+    schedule(edge);
+    time += 100 + random(400);
+  }
+  sim_event edge = {};
+  edge.time = time;
+  edge.type = SIM_EVENT_PIN;
+  edge.dock = dock;
+  edge.pin = pin;
+  edge.level = level;
+  schedule(edge);
+}
+
+uint64_t Simulator::mac(uint8_t dock) const
+{
+  return packMac(m_docks[dock].mac);
+}
+
+int Simulator::dockWithMac(uint64_t mac) const
+{
+  for (uint8_t i = 0; i < SIM_MAX_DOCKS; i++)
+  {
+    if (packMac(m_docks[i].mac) == mac)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+uint32_t Simulator::random(uint32_t bound)
+{
+  return bound == 0 ? 0 : (uint32_t)(nextRandom() % bound);
+}
+
+void Simulator::runAs(uint8_t dock, const std::function<void()> &code)
+{
+  enter(dock);
+  code();
+  leave();
+}
+
+void Simulator::serialInput(uint8_t dock, const std::string &text)
+{
+  m_docks[dock].input += text;
+}
+
+void Simulator::onSerialLine(std::function<void(uint8_t dock, const std::string &line)> listener)
+{
+  m_serialListener = listener;
+}
+
+sim_dock &Simulator::current()
+{
+  if (m_current < 0)
+  {
+    fprintf(stderr, "sim: Arduino call made outside of any dock\n");
+    abort();
+  }
+  return m_docks[m_current];
+}
+
+uint64_t Simulator::dockMicros() const
+{
+  return m_current < 0 ? m_now : m_now + m_docks[m_current].clockOffsetUs;
+}
+
+void Simulator::serialWrite(const char *text, size_t length)
+{
+  sim_dock &dock = current();
+  for (size_t i = 0; i < length; i++)
+  {
+    if (text[i] == '\n')
+    {
+      if (m_config.verbose)
+      {
+        fprintf(stderr, "%10.3f dock%02u | %s\n", m_now / 1000.0, dock.index, dock.line.c_str());
+      }
+      if (m_serialListener)
+      {
+        m_serialListener(dock.index, dock.line);
+      }
+      dock.line.clear();
+    }
+    else if (text[i] != '\r')
+    {
+      dock.line += text[i];
+    }
+  }
+}
+
+/**
+ * @brief the firmware's globals can't be put back to their initial values, so a restarted dock stays off
+ *
+ */
+void Simulator::restart()
+{
+  sim_dock &dock = current();
+  if (m_config.verbose)
+  {
+    fprintf(stderr, "%10.3f dock%02u | <restart, powered off>\n", m_now / 1000.0, dock.index);
+  }
+  dock.running = false;
+}
+
+int Simulator::send(const uint8_t *dest, const uint8_t *data, int length)
+{
+  sim_dock &dock = current();
+  if (length <= 0 || length > 250 || dock.peers.empty())
+  {
+    m_stats.sendErrors++;
+    return -1;
+  }
+  std::vector<uint64_t> destinations;
+  if (dest == NULL) // Every registered peer gets its own frame
+  {
+    destinations = dock.peers;
+  }
+  else if (std::find(dock.peers.begin(), dock.peers.end(), packMac(dest)) != dock.peers.end())
+  {
+    destinations.push_back(packMac(dest));
+  }
+  else
+  {
+    m_stats.sendErrors++;
+    return -1;
+  }
+  m_stats.sendCalls++;
+  for (uint64_t destination : destinations)
+  {
+    std::shared_ptr<sim_frame> frame = std::make_shared<sim_frame>();
+    frame->from = dock.index;
+    for (int i = 0; i < 6; i++)
+    {
+      frame->dest[i] = (uint8_t)(destination >> (40 - 8 * i));
+    }
+    frame->to = isBroadcast(frame->dest) ? -1 : dockWithMac(destination);
+    if (frame->to >= m_config.docks)
+    {
+      frame->to = -1;
+    }
+    memcpy(frame->data, data, length);
+    frame->length = (uint8_t)length;
+    frame->attempts = 0;
+    frame->collided = false;
+    frame->delivered = false;
+    queueFrame(dock.index, frame);
+  }
+  return 0;
+}
+
+void Simulator::schedule(sim_event event)
+{
+  event.order = m_order++;
+  m_events.push(event);
+}
+
+void Simulator::enter(uint8_t dock)
+{
+  m_current = dock;
+}
+
+void Simulator::leave()
+{
+  m_current = -1;
+}
+
+void Simulator::setPin(uint8_t dock, uint8_t pin, uint8_t level)
+{
+  sim_dock &target = m_docks[dock];
+  uint8_t previous = target.pinLevels[pin];
+  target.pinLevels[pin] = level;
+  if (!target.running || target.isrs[pin] == NULL || previous == level)
+  {
+    return;
+  }
+  enter(dock);
+  target.isrs[pin]();
+  leave();
+}
+
+void Simulator::queueFrame(uint8_t dock, std::shared_ptr<sim_frame> frame)
+{
+  m_docks[dock].radio.push_back(frame);
+  if (m_docks[dock].radio.size() == 1)
+  {
+    contend(dock, m_now);
+  }
+}
+
+/**
+ * @brief wait for DIFS and a random backoff before trying to put the front frame on air
+ *
+ */
+void Simulator::contend(uint8_t dock, uint64_t earliest)
+{
+  sim_event attempt = {};
+  attempt.time = earliest + DIFS_US + random(m_config.contentionSlots) * SLOT_US;
+  attempt.type = SIM_EVENT_CONTEND;
+  attempt.dock = dock;
+  schedule(attempt);
+}
+
+/**
+ * @brief the backoff is over: transmit, collide with a frame that started too recently to be heard, or defer
+ *
+ */
+void Simulator::startTransmit(uint8_t dock)
+{
+  std::shared_ptr<sim_frame> frame = m_docks[dock].radio.front();
+  uint64_t busyUntil = 0;
+  boolean sensed = false;
+  for (const std::shared_ptr<sim_frame> &other : m_onAir)
+  {
+    busyUntil = max(busyUntil, other->end);
+    if (!m_config.collisions || m_now - other->start >= SLOT_US)
+    {
+      sensed = true;
+    }
+  }
+  if (sensed) // Carrier sense: try again once the channel is idle
+  {
+    contend(dock, busyUntil);
+    return;
+  }
+  for (const std::shared_ptr<sim_frame> &other : m_onAir) // Started in the same slot, nobody could hear anyone
+  {
+    other->collided = true;
+    frame->collided = true;
+  }
+  frame->start = m_now;
+  frame->end = m_now + airtimeUs(frame->length);
+  m_onAir.push_back(frame);
+  m_stats.framesOnAir++;
+  m_stats.airtimeUs += frame->end - frame->start;
+  sim_event end = {};
+  end.time = frame->end;
+  end.type = SIM_EVENT_TX_END;
+  end.dock = dock;
+  end.frame = frame;
+  schedule(end);
+}
+
+void Simulator::endTransmit(const std::shared_ptr<sim_frame> &frame)
+{
+  m_onAir.erase(std::find(m_onAir.begin(), m_onAir.end(), frame));
+  if (frame->collided)
+  {
+    m_stats.collisions++;
+  }
+  sim_event receive = {};
+  receive.type = SIM_EVENT_RECEIVE;
+  receive.frame = frame;
+  sim_event sent = {};
+  sent.type = SIM_EVENT_SENT;
+  sent.dock = frame->from;
+  sent.frame = frame;
+
+  if (isBroadcast(frame->dest)) // Nobody acks a broadcast, so the sender always hears it went out
+  {
+    for (uint8_t i = 0; i < m_config.docks; i++)
+    {
+      if (i == frame->from || frame->collided)
+      {
+        continue;
+      }
+      if (lost())
+      {
+        m_stats.losses++;
+        continue;
+      }
+      receive.dock = i;
+      receive.time = m_now + m_config.latencyUs + random(m_config.latencyJitterUs + 1);
+      schedule(receive);
+    }
+    sent.time = m_now;
+    sent.status = 0;
+    schedule(sent);
+    finishFrame(frame->from);
+    return;
+  }
+
+  boolean delivered = frame->to >= 0 && !frame->collided && m_docks[frame->to].running;
+  if (delivered && lost())
+  {
+    m_stats.losses++;
+    delivered = false;
+  }
+  if (delivered && !frame->delivered) // The receiving MAC drops retries of a frame it already passed up
+  {
+    receive.dock = frame->to;
+    receive.time = m_now + m_config.latencyUs + random(m_config.latencyJitterUs + 1);
+    schedule(receive);
+  }
+  frame->delivered = frame->delivered || delivered;
+  frame->collided = false; // A retry gets a fresh chance
+  if (delivered && !lost())
+  {
+    sent.time = m_now + SIFS_US + ACK_US;
+    sent.status = 0;
+    schedule(sent);
+    finishFrame(frame->from);
+  }
+  else if (frame->attempts < m_config.macRetries) // No ack, the MAC retransmits on its own
+  {
+    frame->attempts++;
+    m_stats.macRetries++;
+    contend(frame->from, m_now + SIFS_US + ACK_US);
+  }
+  else
+  {
+    m_stats.sendFailures++;
+    sent.time = m_now + SIFS_US + ACK_US;
+    sent.status = 1;
+    schedule(sent);
+    finishFrame(frame->from);
+  }
+}
+
+void Simulator::finishFrame(uint8_t dock)
+{
+  m_docks[dock].radio.pop_front();
+  if (!m_docks[dock].radio.empty())
+  {
+    contend(dock, m_now);
+  }
+}
+
+uint64_t Simulator::airtimeUs(uint8_t length) const
+{
+  return PREAMBLE_US + (FRAME_OVERHEAD_BYTES + length) * US_PER_BYTE;
+}
+
+uint64_t Simulator::nextRandom()
+{
+  return splitMix(m_rng);
+}
+
+boolean Simulator::lost()
+{
+  return m_config.loss > 0 && (nextRandom() >> 11) * (1.0 / 9007199254740992.0) < m_config.loss;
+}
+
+/********************************************************************************************************************************************
+ *                           Arduino core stand-ins
+ ********************************************************************************************************************************************/
+
+HardwareSerial Serial;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  sim_dock &dock = g_sim->current();
+  dock.pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP)
+  {
+    dock.pinLevels[pin] = HIGH; // Nothing is pressed at power on
+  }
+}
+
+int digitalRead(uint8_t pin)
+{
+  return g_sim->current().pinLevels[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  g_sim->current().pinLevels[pin] = value ? HIGH : LOW;
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(uint32_t)(g_sim->dockMicros() / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)(uint32_t)g_sim->dockMicros();
+}
+
+/**
+ * @brief nothing in the firmware blocks, and a simulated dock can't hold up the others, so waiting does nothing
+ *
+ */
+void delay(unsigned long ms)
+{
+  (void)ms;
+}
+
+void yield()
+{
+}
+
+long random(long howBig)
+{
+  if (howBig <= 0)
+  {
+    return 0;
+  }
+  return (long)(splitMix(g_sim->current().rng) % (uint64_t)howBig);
+}
+
+long random(long howSmall, long howBig)
+{
+  if (howSmall >= howBig)
+  {
+    return howSmall;
+  }
+  return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+  g_sim->current().rng = seed;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode)
+{
+  (void)mode; // The firmware only uses CHANGE
+  g_sim->current().isrs[pin] = isr;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  g_sim->current().isrs[pin] = NULL;
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+  (void)baud;
+}
+
+int HardwareSerial::availableForWrite()
+{
+  return 128; // The transmit FIFO is always empty, output costs no simulated time
+}
+
+int HardwareSerial::available()
+{
+  return g_sim->current().input.size();
+}
+
+int HardwareSerial::read()
+{
+  std::string &input = g_sim->current().input;
+  if (input.empty())
+  {
+    return -1;
+  }
+  int c = (uint8_t)input[0];
+  input.erase(0, 1);
+  return c;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  g_sim->serialWrite((const char *)&c, 1);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  g_sim->serialWrite((const char *)buffer, size);
+  return size;
+}
+
+size_t HardwareSerial::print(const char *text)
+{
+  return write((const uint8_t *)text, strlen(text));
+}
+
+size_t HardwareSerial::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t HardwareSerial::print(unsigned char value, int base)
+{
+  return print((unsigned long long)value, base);
+}
+
+size_t HardwareSerial::print(int value, int base)
+{
+  return print((long long)value, base);
+}
+
+size_t HardwareSerial::print(unsigned int value, int base)
+{
+  return print((unsigned long long)value, base);
+}
+
+size_t HardwareSerial::print(long value, int base)
+{
+  return print((long long)value, base);
+}
+
+size_t HardwareSerial::print(unsigned long value, int base)
+{
+  return print((unsigned long long)value, base);
+}
+
+size_t HardwareSerial::print(long long value, int base)
+{
+  if (value < 0 && base == DEC)
+  {
+    return print('-') + print((unsigned long long)-value, base);
+  }
+  return print((unsigned long long)value, base);
+}
+
+size_t HardwareSerial::print(unsigned long long value, int base)
+{
+  char digits[65];
+  char *end = digits + sizeof(digits) - 1;
+  char *start = end;
+  *end = '\0';
+  if (base < 2)
+  {
+    base = DEC;
+  }
+  do
+  {
+    uint8_t digit = value % base;
+    *--start = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value);
+  return print(start);
+}
+
+size_t HardwareSerial::print(double value, int digits)
+{
+  char text[64];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return print(text);
+}
+
+size_t HardwareSerial::println()
+{
+  return print("\r\n");
+}
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+  char text[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  return write((const uint8_t *)text, min((size_t)max(length, 0), sizeof(text) - 1));
+}
+
+void EspClass::restart()
+{
+  g_sim->restart();
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  return (uint32_t)(g_sim->dockMicros() * 80); // 80 MHz
+}
+
+uint8_t EspClass::getCpuFreqMHz()
+{
+  return 80;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  return 40000;
+}
+
+uint32_t EspClass::random()
+{
+  return (uint32_t)splitMix(g_sim->current().hwRng);
+}
+
+uint8_t *ESP8266WiFiClass::macAddress(uint8_t *mac)
+{
+  memcpy(mac, g_sim->current().mac, 6);
+  return mac;
+}
+
+bool ESP8266WiFiClass::mode(uint8_t mode)
+{
+  (void)mode;
+  return true;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifiOff)
+{
+  (void)wifiOff;
+  return true;
+}
+
+/********************************************************************************************************************************************
+ *                           esp now stand-ins
+ ********************************************************************************************************************************************/
+
+int esp_now_init(void)
+{
+  return 0;
+}
+
+int esp_now_deinit(void)
+{
+  return 0;
+}
+
+int esp_now_set_self_role(uint8_t role)
+{
+  (void)role;
+  return 0;
+}
+
+int esp_now_register_recv_cb(esp_now_recv_cb_t cb)
+{
+  g_sim->current().recvCallback = cb;
+  return 0;
+}
+
+int esp_now_unregister_recv_cb(void)
+{
+  g_sim->current().recvCallback = NULL;
+  return 0;
+}
+
+int esp_now_register_send_cb(esp_now_send_cb_t cb)
+{
+  g_sim->current().sendCallback = cb;
+  return 0;
+}
+
+int esp_now_unregister_send_cb(void)
+{
+  g_sim->current().sendCallback = NULL;
+  return 0;
+}
+
+int esp_now_add_peer(uint8_t *mac_addr, uint8_t role, uint8_t channel, uint8_t *key, uint8_t key_len)
+{
+  (void)role;
+  (void)channel;
+  (void)key;
+  (void)key_len;
+  std::vector<uint64_t> &peers = g_sim->current().peers;
+  uint64_t mac = packMac(mac_addr);
+  if (peers.size() >= ESP_NOW_MAX_PEERS || std::find(peers.begin(), peers.end(), mac) != peers.end())
+  {
+    return -1;
+  }
+  peers.push_back(mac);
+  return 0;
+}
+
+int esp_now_del_peer(uint8_t *mac_addr)
+{
+  std::vector<uint64_t> &peers = g_sim->current().peers;
+  std::vector<uint64_t>::iterator found = std::find(peers.begin(), peers.end(), packMac(mac_addr));
+  if (found == peers.end())
+  {
+    return -1;
+  }
+  peers.erase(found);
+  return 0;
+}
+
+int esp_now_send(uint8_t *da, uint8_t *data, int len)
+{
+  return g_sim->send(da, data, len);
+}
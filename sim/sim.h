@@ -0,0 +1,346 @@
+#pragma once
+
+#include <Arduino.h>
+#include <espnow.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+/**
+ * @brief the most docks one simulation can run, one per namespace instance in docks.cpp
+ *
+ */
+static const uint8_t SIM_MAX_DOCKS = 20;
+
+/**
+ * @brief the buttons a script can press, in the order of sim_dock_api::buttonPins
+ *
+ */
+enum sim_button : uint8_t
+{
+  SIM_BUTTON_SYNC,
+  SIM_BUTTON_PREV,
+  SIM_BUTTON_NEXT,
+  SIM_BUTTON_FLASH,
+  SIM_BUTTON_COUNT
+};
+
+/**
+ * @brief which phase a dock's firmware is in, read from its globals
+ *
+ * SIM_PHASE_OTHER: between phases, such as waiting for the first player or the pause before taking turns
+ * SIM_PHASE_SYNC: waiting for the sync button, or holding it and beaconing
+ * SIM_PHASE_CATCH_UP: reconciling peer lists after sync was released
+ * SIM_PHASE_ORDER: waiting for a press to choose its place in the turn order
+ * SIM_PHASE_CHOSEN: has its place, waiting for everyone else to choose
+ * SIM_PHASE_TURNS: taking turns
+ *
+ */
+enum sim_phase : uint8_t
+{
+  SIM_PHASE_OTHER,
+  SIM_PHASE_SYNC,
+  SIM_PHASE_CATCH_UP,
+  SIM_PHASE_ORDER,
+  SIM_PHASE_CHOSEN,
+  SIM_PHASE_TURNS
+};
+
+/**
+ * @brief overrides for the firmware's TUNABLE timing constants, SIM_TUNING_UNSET keeps the firmware's value
+ *
+ * 0 is a real setting for some of them (TX_BATCH_WINDOW_MS), so it can't double as "not set".
+ *
+ */
+#define SIM_TUNING_UNSET UINT32_MAX
+
+typedef struct sim_tuning
+{
+  uint32_t beaconStartMs = SIM_TUNING_UNSET;     // SYNC_BEACON_START_MS
+  uint32_t beaconMinMs = SIM_TUNING_UNSET;       // SYNC_BEACON_MIN_MS
+  uint32_t beaconMaxMs = SIM_TUNING_UNSET;       // SYNC_BEACON_MAX_MS
+  uint32_t beaconPerPeerMs = SIM_TUNING_UNSET;   // SYNC_BEACON_MS_PER_PEER
+  uint32_t catchUpMs = SIM_TUNING_UNSET;         // CATCH_UP_MS
+  uint32_t restartHoldMs = SIM_TUNING_UNSET;     // RESTART_HOLD_MS
+  uint32_t txBackoffMs = SIM_TUNING_UNSET;       // TX_BACKOFF_BASE_MS
+  uint32_t txResultTimeoutMs = SIM_TUNING_UNSET; // TX_RESULT_TIMEOUT_MS
+  uint32_t txBatchWindowMs = SIM_TUNING_UNSET;   // TX_BATCH_WINDOW_MS
+} sim_tuning;
+
+/**
+ * @brief one copy of the firmware, compiled into its own namespace by docks.cpp
+ *
+ * The accessors read that copy's globals directly and don't call into the Arduino stand-ins,
+ * so they're safe to call from the harness between events.
+ *
+ */
+typedef struct sim_dock_api
+{
+  void (*setup)();
+  void (*loop)();
+  void (*tune)(sim_tuning &tuning); // apply the overrides that are set, then fill in every field with the value in use
+  uint8_t buttonPins[SIM_BUTTON_COUNT];
+  uint8_t (*peerCount)();
+  uint32_t (*peerDigest)();
+  uint64_t (*currentPlayer)();
+  uint64_t (*firstPlayer)();
+  uint8_t (*turnOrderCount)();
+  sim_phase (*phase)();
+} sim_dock_api;
+
+extern const sim_dock_api SIM_DOCKS[SIM_MAX_DOCKS];
+
+/**
+ * @brief the channel and the docks' surroundings
+ *
+ */
+typedef struct sim_config
+{
+  uint8_t docks = 4;
+  uint32_t seed = 1;
+  double loss = 0.0;               // chance that a receiver misses a frame, drawn again for every receiver and every ack
+  uint32_t latencyUs = 300;        // from the end of a frame on air to the receive callback
+  uint32_t latencyJitterUs = 200;  // uniform extra latency on top of latencyUs
+  boolean collisions = true;       // frames that start within one slot of each other are both lost
+  uint8_t contentionSlots = 16;    // backoff window before each frame, in slots
+  uint8_t macRetries = 3;          // retransmits of an unacknowledged unicast frame before the send callback reports failure
+  uint32_t loopPeriodUs = 1000;    // how often each dock's loop() runs
+  uint32_t bootSpreadUs = 500000;  // docks power on at a uniform random time within this window
+  uint8_t bounceEdges = 0;         // extra contact bounces on every button press and release
+  boolean verbose = false;         // echo every dock's Serial output to stderr
+  sim_tuning tuning;               // applied to every dock before setup()
+} sim_config;
+
+/**
+ * @brief counters over the whole channel
+ *
+ */
+typedef struct sim_stats
+{
+  uint32_t sendCalls = 0;    // esp_now_send() calls that were accepted
+  uint32_t sendErrors = 0;   // esp_now_send() calls that returned an error
+  uint32_t framesOnAir = 0;  // transmissions, counting each MAC retry
+  uint32_t collisions = 0;   // transmissions lost to an overlapping one
+  uint32_t deliveries = 0;   // receive callbacks
+  uint32_t losses = 0;       // frames a receiver missed to random loss
+  uint32_t macRetries = 0;   // unicast retransmits after a missing ack
+  uint32_t sendFailures = 0; // send callbacks that reported failure
+  uint64_t airtimeUs = 0;    // total time the channel carried a frame
+} sim_stats;
+
+/**
+ * @brief a single 802.11 frame on its way from one dock's radio to another's, or to everyone's
+ *
+ */
+typedef struct sim_frame
+{
+  uint8_t from;
+  int to; // a dock index, or -1 for broadcast or a peer that doesn't exist
+  uint8_t dest[6];
+  uint8_t data[250];
+  uint8_t length;
+  uint8_t attempts;
+  boolean collided;
+  boolean delivered;
+  uint64_t start;
+  uint64_t end;
+} sim_frame;
+
+/**
+ * @brief everything the Arduino stand-ins need to know about one virtual dock
+ *
+ */
+typedef struct sim_dock
+{
+  uint8_t index;
+  uint8_t mac[6];
+  boolean running;
+  int64_t clockOffsetUs; // added to the simulation clock for this dock's millis() and micros()
+  uint64_t rng;   // random()
+  uint64_t hwRng; // RANDOM_REG32
+  uint8_t pinModes[32];
+  uint8_t pinLevels[32];
+  void (*isrs[32])();
+  esp_now_recv_cb_t recvCallback;
+  esp_now_send_cb_t sendCallback;
+  std::vector<uint64_t> peers; // registered esp now peers, as packed addresses in registration order
+  std::deque<std::shared_ptr<sim_frame>> radio; // frames waiting for the channel, the front one is contending or on air
+  std::string line; // Serial output since the last newline
+  std::string input; // typed into the serial monitor and not read yet
+} sim_dock;
+
+/**
+ * @brief a discrete-event simulation of N docks sharing one esp now channel
+ *
+ * Time is virtual and counted in microseconds, and every random choice comes from one seeded generator, so a run
+ * with the same config and script always produces the same result. Each dock's loop() runs every loopPeriodUs
+ * at its own phase, callbacks run when their frame arrives, and button edges run the pin's interrupt immediately,
+ * all in a single thread with the right dock selected for the stand-ins.
+ *
+ * The radio is a simple 802.11 DCF: a frame waits DIFS plus a random number of slots once the channel is idle,
+ * takes 1 Mbps long preamble airtime, and collides with any frame that started less than a slot earlier.
+ * Unicast frames are acked and retried by the MAC, broadcasts are not.
+ *
+ */
+class Simulator
+{
+public:
+  explicit Simulator(const sim_config &config);
+
+  /**
+   * @brief power on every dock at its boot time and start running their loops
+   *
+   */
+  void start();
+
+  /**
+   * @brief process every event up to and including a point in simulated time
+   *
+   */
+  void runUntil(uint64_t timeUs);
+
+  /**
+   * @brief run an action at a point in simulated time, outside of any dock
+   *
+   */
+  void at(uint64_t timeUs, std::function<void()> action);
+
+  /**
+   * @brief press or release a button now, with contact bounce if configured
+   *
+   */
+  void setButton(uint8_t dock, sim_button button, boolean down);
+
+  uint64_t now() const
+  {
+    return m_now;
+  }
+
+  uint8_t docks() const
+  {
+    return m_config.docks;
+  }
+
+  const sim_stats &stats() const
+  {
+    return m_stats;
+  }
+
+  const sim_dock_api &api(uint8_t dock) const
+  {
+    return SIM_DOCKS[dock];
+  }
+
+  boolean running(uint8_t dock) const
+  {
+    return m_docks[dock].running;
+  }
+
+  /**
+   * @brief a dock's mac address, packed the same way as MacKey
+   *
+   */
+  uint64_t mac(uint8_t dock) const;
+
+  /**
+   * @brief the dock with a packed mac address, or -1
+   *
+   */
+  int dockWithMac(uint64_t mac) const;
+
+  /**
+   * @brief a uniform random number below bound from the simulation's generator, for scripts and scenarios
+   *
+   */
+  uint32_t random(uint32_t bound);
+
+  /**
+   * @brief run code as one of the docks outside of any event, for tools that call firmware functions directly
+   *
+   */
+  void runAs(uint8_t dock, const std::function<void()> &code);
+
+  /**
+   * @brief type text into a dock's serial monitor, for its loop() to read
+   *
+   */
+  void serialInput(uint8_t dock, const std::string &text);
+
+  /**
+   * @brief call listener with every line of serial output any dock prints, verbose or not
+   *
+   */
+  void onSerialLine(std::function<void(uint8_t dock, const std::string &line)> listener);
+
+  // Called by the Arduino and esp now stand-ins for the current dock
+
+  sim_dock &current();
+  uint64_t dockMicros() const;
+  void serialWrite(const char *text, size_t length);
+  void restart();
+  int send(const uint8_t *dest, const uint8_t *data, int length);
+
+private:
+  enum sim_event_type : uint8_t
+  {
+    SIM_EVENT_BOOT,
+    SIM_EVENT_LOOP,
+    SIM_EVENT_CONTEND,
+    SIM_EVENT_TX_END,
+    SIM_EVENT_RECEIVE,
+    SIM_EVENT_SENT,
+    SIM_EVENT_PIN,
+    SIM_EVENT_ACTION
+  };
+
+  typedef struct sim_event
+  {
+    uint64_t time;
+    uint64_t order; // ties run in the order they were scheduled
+    sim_event_type type;
+    uint8_t dock;
+    uint8_t pin;
+    uint8_t level;
+    uint8_t status;
+    std::shared_ptr<sim_frame> frame;
+    std::function<void()> action;
+
+    bool operator>(const sim_event &other) const
+    {
+      return time != other.time ? time > other.time : order > other.order;
+    }
+  } sim_event;
+
+  void schedule(sim_event event);
+  void enter(uint8_t dock);
+  void leave();
+  void setPin(uint8_t dock, uint8_t pin, uint8_t level);
+  void queueFrame(uint8_t dock, std::shared_ptr<sim_frame> frame);
+  void contend(uint8_t dock, uint64_t earliest);
+  void startTransmit(uint8_t dock);
+  void endTransmit(const std::shared_ptr<sim_frame> &frame);
+  void finishFrame(uint8_t dock);
+  uint64_t airtimeUs(uint8_t length) const;
+  uint64_t nextRandom();
+  boolean lost();
+
+  sim_config m_config;
+  sim_stats m_stats;
+  sim_dock m_docks[SIM_MAX_DOCKS];
+  std::priority_queue<sim_event, std::vector<sim_event>, std::greater<sim_event>> m_events;
+  std::vector<std::shared_ptr<sim_frame>> m_onAir;
+  uint64_t m_now = 0;
+  uint64_t m_order = 0;
+  uint64_t m_rng;
+  int m_current = -1;
+  std::function<void(uint8_t dock, const std::string &line)> m_serialListener;
+};
+
+/**
+ * @brief the simulator the stand-ins answer to, set by the Simulator constructor
+ *
+ */
+extern Simulator *g_sim;
@@ -0,0 +1,64 @@
+#include "options.h"
+#include "sweep.h"
+#include <stdio.h>
+
+static void printUsage()
+{
+  fprintf(stderr, "usage: gamedock-sim [options]\n"
+                  "       gamedock-sim sweep [--runs N] [--jobs N] [options, numbers can be lists like 2,4,8]\n");
+  printOptions();
+}
+
+/**
+ * @brief print a time, or n/a if it never happened
+ *
+ */
+static void printMs(const char *name, double ms)
+{
+  if (ms < 0)
+  {
+    printf(" %s=n/a", name);
+  }
+  else
+  {
+    printf(" %s=%.1f", name, ms);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && strcmp(argv[1], "sweep") == 0)
+  {
+    return runSweep(argc - 1, argv + 1);
+  }
+  sim_config config;
+  scenario_options options;
+  if (!parseArguments(argc, argv, config, options, NULL))
+  {
+    printUsage();
+    return 1;
+  }
+
+  scenario_result result = runScenario(config, options);
+
+  double turnSum = 0;
+  double turnMax = -1;
+  for (double latency : result.turnLatencyMs)
+  {
+    turnSum += latency;
+    turnMax = max(turnMax, latency);
+  }
+  printf("docks=%u seed=%u loss=%.3f", config.docks, config.seed, config.loss);
+  printMs("converged_ms", result.convergedMs);
+  printMs("ready_ms", result.readyMs);
+  printMs("turns_ms", result.turnsMs);
+  printf(" turn_passes=%u", (unsigned)result.turnLatencyMs.size());
+  printMs("turn_mean_ms", result.turnLatencyMs.empty() ? -1 : turnSum / result.turnLatencyMs.size());
+  printMs("turn_max_ms", turnMax);
+  printf(" sends=%u frames=%u collisions=%u losses=%u mac_retries=%u send_failures=%u airtime=%.1f%%",
+         result.stats.sendCalls, result.stats.framesOnAir, result.stats.collisions, result.stats.losses,
+         result.stats.macRetries, result.stats.sendFailures,
+         result.endMs > 0 ? result.stats.airtimeUs / (result.endMs * 10.0) : 0.0);
+  printf(" restarts=%u end_ms=%.0f result=%s\n", result.restarts, result.endMs, result.finished ? "ok" : "timeout");
+  return result.finished ? 0 : 2;
+}
@@ -0,0 +1,309 @@
+#include "sweep.h"
+#include "options.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <map>
+
+/**
+ * @brief the most turn pass latencies a session reports
+ *
+ */
+static const uint8_t SWEEP_MAX_TURNS = 16;
+
+/**
+ * @brief what a session's process sends back, small enough that one write() to the shared pipe is atomic
+ *
+ */
+typedef struct sweep_record
+{
+  uint32_t session;
+  uint8_t finished;
+  uint8_t turnCount;
+  float convergedMs;
+  float readyMs;
+  float turnMs[SWEEP_MAX_TURNS];
+  uint32_t frames;
+  uint32_t sendFailures;
+} sweep_record;
+
+static_assert(sizeof(sweep_record) <= PIPE_BUF, "sweep records have to be written atomically");
+
+/**
+ * @brief the value at a percentile of some samples, by nearest rank, or -1 if there are none
+ *
+ */
+static double percentile(std::vector<double> samples, double fraction)
+{
+  if (samples.empty())
+  {
+    return -1;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (size_t)ceil(fraction * samples.size());
+  return samples[rank > 0 ? rank - 1 : 0];
+}
+
+static void printValue(double value)
+{
+  if (value < 0)
+  {
+    printf(",");
+  }
+  else
+  {
+    printf(",%.1f", value);
+  }
+}
+
+/**
+ * @brief whether a parameter gets a CSV column after docks and loss: the tunables always, anything else if it's swept
+ *
+ */
+static boolean listedColumn(uint8_t parameter, const std::vector<std::vector<double>> &sweep)
+{
+  const sim_parameter &info = SIM_PARAMETERS[parameter];
+  if (strcmp(info.option, "docks") == 0 || strcmp(info.option, "loss") == 0)
+  {
+    return false; // Always the first two columns
+  }
+  return info.listed || !sweep[parameter].empty();
+}
+
+/**
+ * @brief fill in the tunables that weren't overridden with the firmware's own values
+ *
+ */
+static void resolveTuning(sim_tuning &tuning, const sim_tuning &defaults)
+{
+  uint32_t sim_tuning::*fields[] = {&sim_tuning::beaconStartMs, &sim_tuning::beaconMinMs, &sim_tuning::beaconMaxMs,
+                                    &sim_tuning::beaconPerPeerMs, &sim_tuning::catchUpMs, &sim_tuning::restartHoldMs,
+                                    &sim_tuning::txBackoffMs, &sim_tuning::txResultTimeoutMs,
+                                    &sim_tuning::txBatchWindowMs};
+  for (uint32_t sim_tuning::*field : fields)
+  {
+    if (tuning.*field == SIM_TUNING_UNSET)
+    {
+      tuning.*field = defaults.*field;
+    }
+  }
+}
+
+/**
+ * @brief pull out the sweep's own options, leaving everything else for parseArguments()
+ *
+ */
+static boolean takeSweepOptions(int argc, char **argv, std::vector<char *> &rest, uint32_t &runs, uint32_t &jobs)
+{
+  rest.push_back(argv[0]);
+  for (int i = 1; i < argc; i++)
+  {
+    boolean isRuns = strcmp(argv[i], "--runs") == 0;
+    boolean isJobs = strcmp(argv[i], "--jobs") == 0;
+    if (!isRuns && !isJobs)
+    {
+      rest.push_back(argv[i]);
+      continue;
+    }
+    if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+    {
+      fprintf(stderr, "sim: %s needs a positive number\n", argv[i]);
+      return false;
+    }
+    (isRuns ? runs : jobs) = atoi(argv[++i]);
+  }
+  return true;
+}
+
+int runSweep(int argc, char **argv)
+{
+  sim_config config;
+  scenario_options options;
+  std::vector<std::vector<double>> sweep;
+  std::vector<char *> rest;
+  uint32_t runs = 100;
+  uint32_t jobs = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+  if (!takeSweepOptions(argc, argv, rest, runs, jobs) ||
+      !parseArguments(rest.size(), rest.data(), config, options, &sweep))
+  {
+    fprintf(stderr, "usage: gamedock-sim sweep [--runs N] [--jobs N] [options, numbers can be lists like 2,4,8]\n");
+    printOptions();
+    return 1;
+  }
+  config.verbose = false;
+  options.turns = min(options.turns, (uint32_t)SWEEP_MAX_TURNS);
+
+  // The firmware's own values for the tunables, so the CSV shows what was actually run
+  sim_tuning defaults;
+  SIM_DOCKS[0].tune(defaults);
+
+  // Every combination of the lists, in the order they were given
+  std::vector<uint8_t> swept;
+  for (uint8_t i = 0; i < SIM_PARAMETER_COUNT; i++)
+  {
+    if (!sweep[i].empty())
+    {
+      swept.push_back(i);
+    }
+  }
+  std::vector<std::vector<double>> combinations(1, std::vector<double>());
+  for (uint8_t parameter : swept)
+  {
+    std::vector<std::vector<double>> grown;
+    for (const std::vector<double> &combination : combinations)
+    {
+      for (double value : sweep[parameter])
+      {
+        grown.push_back(combination);
+        grown.back().push_back(value);
+      }
+    }
+    combinations = grown;
+  }
+  uint32_t baseSeed = config.seed;
+  uint32_t total = combinations.size() * runs;
+  fprintf(stderr, "sim: %u combinations x %u runs on %u jobs\n", (unsigned)combinations.size(), runs, jobs);
+
+  int pipeFds[2];
+  if (pipe(pipeFds) != 0)
+  {
+    perror("sim: pipe");
+    return 1;
+  }
+  fcntl(pipeFds[0], F_SETFL, O_NONBLOCK);
+  std::vector<sweep_record> records(total);
+  std::vector<boolean> reported(total, false);
+  std::map<pid_t, uint32_t> running;
+  uint32_t next = 0;
+  uint32_t completed = 0;
+  while (next < total || !running.empty())
+  {
+    while (running.size() < jobs && next < total)
+    {
+      pid_t pid = fork();
+      if (pid == 0) // The session, in a fresh copy of every dock
+      {
+        close(pipeFds[0]);
+        sim_config sessionConfig = config;
+        scenario_options sessionOptions = options;
+        const std::vector<double> &combination = combinations[next / runs];
+        for (size_t i = 0; i < swept.size(); i++)
+        {
+          SIM_PARAMETERS[swept[i]].apply(sessionConfig, sessionOptions, combination[i]);
+        }
+        sessionConfig.docks = constrain(sessionConfig.docks, 1, SIM_MAX_DOCKS);
+        sessionConfig.seed = baseSeed + next % runs;
+        scenario_result result = runScenario(sessionConfig, sessionOptions);
+        sweep_record record = {};
+        record.session = next;
+        record.finished = result.finished;
+        record.convergedMs = result.convergedMs;
+        record.readyMs = result.readyMs;
+        record.turnCount = min(result.turnLatencyMs.size(), (size_t)SWEEP_MAX_TURNS);
+        for (uint8_t i = 0; i < record.turnCount; i++)
+        {
+          record.turnMs[i] = result.turnLatencyMs[i];
+        }
+        record.frames = result.stats.framesOnAir;
+        record.sendFailures = result.stats.sendFailures;
+        ssize_t written = write(pipeFds[1], &record, sizeof(record));
+        _exit(written == sizeof(record) ? 0 : 1);
+      }
+      if (pid < 0)
+      {
+        perror("sim: fork");
+        break;
+      }
+      running[pid] = next++;
+    }
+    pid_t finished = waitpid(-1, NULL, 0);
+    if (finished < 0 && errno != EINTR)
+    {
+      perror("sim: waitpid");
+      return 1;
+    }
+    sweep_record record;
+    while (read(pipeFds[0], &record, sizeof(record)) == sizeof(record)) // A crashed session just never reports
+    {
+      records[record.session] = record;
+      reported[record.session] = true;
+    }
+    if (running.erase(finished) && ++completed % max(1u, total / 20) == 0)
+    {
+      fprintf(stderr, "sim: %u/%u sessions\n", completed, total);
+    }
+  }
+  close(pipeFds[0]);
+  close(pipeFds[1]);
+
+  // One row per combination
+  printf("docks,loss");
+  for (uint8_t i = 0; i < SIM_PARAMETER_COUNT; i++)
+  {
+    if (listedColumn(i, sweep))
+    {
+      printf(",%s", SIM_PARAMETERS[i].column);
+    }
+  }
+  printf(",runs,success_rate,crashes,converged_p50_ms,sync_p50_ms,sync_p99_ms,turn_p50_ms,turn_p99_ms,"
+         "frames_mean,send_failures_mean\n");
+  for (size_t c = 0; c < combinations.size(); c++)
+  {
+    sim_config rowConfig = config;
+    scenario_options rowOptions = options;
+    for (size_t i = 0; i < swept.size(); i++)
+    {
+      SIM_PARAMETERS[swept[i]].apply(rowConfig, rowOptions, combinations[c][i]);
+    }
+    resolveTuning(rowConfig.tuning, defaults);
+    printf("%u,%g", constrain(rowConfig.docks, 1, SIM_MAX_DOCKS), rowConfig.loss);
+    for (uint8_t i = 0; i < SIM_PARAMETER_COUNT; i++)
+    {
+      if (listedColumn(i, sweep))
+      {
+        printf(",%g", SIM_PARAMETERS[i].read(rowConfig, rowOptions));
+      }
+    }
+
+    uint32_t successes = 0;
+    uint32_t crashes = 0;
+    double frames = 0;
+    double sendFailures = 0;
+    std::vector<double> converged, ready, turns;
+    for (uint32_t run = 0; run < runs; run++)
+    {
+      uint32_t session = c * runs + run;
+      if (!reported[session])
+      {
+        crashes++;
+        continue;
+      }
+      const sweep_record &record = records[session];
+      frames += record.frames;
+      sendFailures += record.sendFailures;
+      if (!record.finished)
+      {
+        continue;
+      }
+      successes++;
+      converged.push_back(record.convergedMs);
+      ready.push_back(record.readyMs);
+      turns.insert(turns.end(), record.turnMs, record.turnMs + record.turnCount);
+    }
+    uint32_t reports = runs - crashes;
+    printf(",%u,%.3f,%u", runs, (double)successes / runs, crashes);
+    printValue(percentile(converged, 0.5));
+    printValue(percentile(ready, 0.5));
+    printValue(percentile(ready, 0.99));
+    printValue(percentile(turns, 0.5));
+    printValue(percentile(turns, 0.99));
+    printValue(reports ? frames / reports : -1);
+    printValue(reports ? sendFailures / reports : -1);
+    printf("\n");
+  }
+  return 0;
+}
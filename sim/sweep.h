@@ -0,0 +1,12 @@
+#pragma once
+
+/**
+ * @brief gamedock-sim sweep: run many sessions over a grid of parameters on every core and print CSV
+ *
+ * Every numeric option takes a comma separated list, and every combination of the lists is run --runs times with
+ * seeds counting up from --seed, the same seeds for every combination. Each session runs in its own forked process,
+ * since the firmware's globals can't be put back the way they started, and --jobs of them run at once.
+ *
+ * @return the process exit code
+ */
+int runSweep(int argc, char **argv);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Arduino.h>
+#include "macKey.h"
+
+/**
+ * @brief the number of bits set for each address added to a BloomFilter
+ *
+ */
+static const uint8_t BLOOM_HASHES = 3;
+
+/**
+ * @brief a fixed-size Bloom filter of mac addresses that can be sent as-is inside a packed message
+ *
+ * mightContain() never says no for an address that was added, and says yes for one that wasn't with a
+ * probability of roughly (1 - e^(-BLOOM_HASHES * n / bits))^BLOOM_HASHES, about 5% for 20 addresses in 16 bytes.
+ * Each of the BLOOM_HASHES bit positions is a different slice of MacKey::hash().
+ *
+ * @tparam BYTES the size of the filter, at most 32 so each position fits in one byte
+ */
+template <uint8_t BYTES>
+struct __attribute__((packed)) BloomFilter
+{
+  static_assert(BYTES > 0 && BYTES <= 32, "BloomFilter positions have to fit in a byte");
+
+  uint8_t bits[BYTES];
+
+  /**
+   * @brief empty the filter
+   *
+   */
+  void clear()
+  {
+    memset(bits, 0, BYTES);
+  }
+
+  /**
+   * @brief add an address
+   *
+   */
+  void add(MacKey mac)
+  {
+    uint32_t hash = mac.hash();
+    for (uint8_t i = 0; i < BLOOM_HASHES; i++)
+    {
+      uint8_t position = bitFor(hash, i);
+      bits[position / 8] |= 1 << (position % 8);
+    }
+  }
+
+  /**
+   * @brief whether an address was probably added, false means it definitely wasn't
+   *
+   */
+  boolean mightContain(MacKey mac) const
+  {
+    uint32_t hash = mac.hash();
+    for (uint8_t i = 0; i < BLOOM_HASHES; i++)
+    {
+      uint8_t position = bitFor(hash, i);
+      if ((bits[position / 8] & (1 << (position % 8))) == 0)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  static uint8_t bitFor(uint32_t hash, uint8_t index)
+  {
+    return (uint8_t)(hash >> (index * 8)) % (BYTES * 8);
+  }
+};
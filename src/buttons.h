@@ -0,0 +1,202 @@
+#pragma once
+
+#include <Arduino.h>
+#include "spscRing.h"
+
+/**
+ * @brief how long a button has to stay at a new level before the change counts
+ *
+ */
+static const uint32_t DEBOUNCE_MS = 30;
+
+/**
+ * @brief what happened to a button
+ *
+ * BUTTON_PRESSED: the button went down
+ * BUTTON_RELEASED: the button came back up, duration is how long it was down
+ * BUTTON_HELD: the button has been down for its hold time, sent once per press
+ *
+ */
+enum button_event_type : uint8_t
+{
+  BUTTON_PRESSED,
+  BUTTON_RELEASED,
+  BUTTON_HELD
+};
+
+/**
+ * @brief one debounced button event, handed to loop() by Buttons::nextEvent()
+ *
+ * uint8_t button:
+ * The index the button was registered with in Buttons::begin()
+ *
+ * uint32_t duration:
+ * How long the button had been down, 0 for BUTTON_PRESSED
+ *
+ */
+typedef struct button_event
+{
+  uint8_t button;
+  button_event_type type;
+  uint32_t duration;
+} button_event;
+
+/**
+ * @brief a raw level change, pushed by the pin's interrupt
+ *
+ */
+typedef struct button_edge
+{
+  uint8_t button;
+  uint32_t time;
+} button_edge;
+
+/**
+ * @brief interrupt-driven buttons with per-pin debouncing
+ *
+ * Each pin's CHANGE interrupt only calls onEdge(), which pushes the time of the edge onto a lock-free ring.
+ * nextEvent() runs in loop(): it drains the ring, waits for each pin to settle for DEBOUNCE_MS, and turns the
+ * settled levels into exactly one BUTTON_PRESSED and one BUTTON_RELEASED per physical press, plus one
+ * BUTTON_HELD once the press has lasted the button's hold time.
+ * When no button is down or bouncing, nextEvent() only checks the ring and a few flags, so idle buttons cost nothing.
+ *
+ * @tparam COUNT the number of buttons
+ */
+template <uint8_t COUNT>
+class Buttons
+{
+public:
+  /**
+   * @brief set up one button, the caller attaches an interrupt that calls onEdge(index)
+   *
+   * @param index which button this is, below COUNT
+   * @param pin the GPIO the button is on
+   * @param activeLow true if the pin reads LOW while the button is down
+   * @param holdMs how long before BUTTON_HELD is sent, 0 for never
+   */
+  void begin(uint8_t index, uint8_t pin, boolean activeLow, uint32_t holdMs)
+  {
+    button_state &button = m_buttons[index];
+    button.pin = pin;
+    button.activeLow = activeLow;
+    button.holdMs = holdMs;
+    pinMode(pin, activeLow ? INPUT_PULLUP : INPUT);
+    button.down = readDown(button);
+    button.downSince = millis();
+    button.heldSent = true; // A button that's already down at boot doesn't count as held
+    button.settling = false;
+  }
+
+  /**
+   * @brief called from the pin's interrupt on every level change, including bounces
+   *
+   */
+  IRAM_ATTR void onEdge(uint8_t index)
+  {
+    button_edge edge = {index, (uint32_t)millis()};
+    m_edges.push(edge);
+  }
+
+  /**
+   * @brief get the next debounced event, call until it returns false
+   *
+   * @param event filled in with the event if there is one
+   * @return false if there are no more events right now
+   */
+  boolean nextEvent(button_event &event)
+  {
+    const button_edge *edge;
+    while ((edge = m_edges.peek()) != NULL) // Each edge restarts its button's settling time
+    {
+      button_state &button = m_buttons[edge->button];
+      button.settling = true;
+      button.lastEdge = edge->time;
+      m_edges.pop();
+    }
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < COUNT; i++)
+    {
+      button_state &button = m_buttons[i];
+      if (button.settling && now - button.lastEdge >= DEBOUNCE_MS)
+      {
+        button.settling = false;
+        boolean down = readDown(button);
+        if (down != button.down) // Bounces that ended where they started don't count
+        {
+          button.down = down;
+          event.button = i;
+          if (down)
+          {
+            button.downSince = button.lastEdge;
+            button.heldSent = false;
+            event.type = BUTTON_PRESSED;
+            event.duration = 0;
+          }
+          else
+          {
+            event.type = BUTTON_RELEASED;
+            event.duration = button.lastEdge - button.downSince;
+          }
+          return true;
+        }
+      }
+      if (button.down && !button.heldSent && button.holdMs != 0 && now - button.downSince >= button.holdMs)
+      {
+        button.heldSent = true;
+        event.button = i;
+        event.type = BUTTON_HELD;
+        event.duration = now - button.downSince;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief whether a button is down, after debouncing
+   *
+   */
+  boolean isDown(uint8_t index) const
+  {
+    return m_buttons[index].down;
+  }
+
+  /**
+   * @brief how long a button has been down, 0 if it's up
+   *
+   */
+  uint32_t downFor(uint8_t index) const
+  {
+    return m_buttons[index].down ? millis() - m_buttons[index].downSince : 0;
+  }
+
+  /**
+   * @brief the number of edges lost because loop() didn't drain them in time
+   *
+   */
+  uint32_t dropped() const
+  {
+    return m_edges.dropped();
+  }
+
+private:
+  typedef struct button_state
+  {
+    uint8_t pin;
+    boolean activeLow;
+    boolean down;     // the debounced level
+    boolean settling; // an edge arrived and the pin hasn't been quiet for DEBOUNCE_MS yet
+    boolean heldSent;
+    uint32_t holdMs;
+    uint32_t lastEdge;
+    uint32_t downSince;
+  } button_state;
+
+  static boolean readDown(const button_state &button)
+  {
+    return (digitalRead(button.pin) == LOW) == button.activeLow;
+  }
+
+  button_state m_buttons[COUNT] = {};
+  SpscRing<button_edge, 16> m_edges;
+};
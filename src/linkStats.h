@@ -0,0 +1,172 @@
+#pragma once
+
+#include <Arduino.h>
+#include "macKey.h"
+#include "peerTable.h"
+
+/**
+ * @brief what has been sent to and heard from one purpose or one peer
+ *
+ * uint32_t txFrames:
+ * Frames handed to esp_now_send(), counting each peer of a send to all. A purpose counts each of its messages in a
+ * batch, a peer counts the batch once, and the same goes for the results and everything received
+ *
+ * uint32_t txSuccess, txFail:
+ * Results reported by OnDataSent()
+ *
+ * uint32_t retransmits:
+ * Frames sent again because a peer hadn't acknowledged them, counted in txFrames too
+ *
+ * uint32_t rxFrames, rxBytes:
+ * Well-formed frames received, duplicates included
+ *
+ * uint32_t duplicates:
+ * Received frames dropped as duplicate or stale
+ *
+ */
+typedef struct link_counters
+{
+  uint32_t txFrames;
+  uint32_t txSuccess;
+  uint32_t txFail;
+  uint32_t retransmits;
+  uint32_t rxFrames;
+  uint32_t rxBytes;
+  uint32_t duplicates;
+} link_counters;
+
+/**
+ * @brief a peer's delivery success rate starts here, full marks, and moves towards each result by 1/2^LINK_EWMA_SHIFT
+ *
+ * With a shift of 3 the last eight or so results count for most of the rate, so a seat that starts losing frames
+ * shows up within a couple of turns.
+ *
+ */
+static const uint16_t LINK_EWMA_ONE = 0xFFFF;
+static const uint8_t LINK_EWMA_SHIFT = 3;
+
+/**
+ * @brief packet counters for every purpose and every peer, with a moving average of each peer's delivery success rate
+ *
+ * Purposes are indexed by their type byte, anything out of range is counted under purpose 0. Peers get a slot the
+ * first time they're seen and keep it until reset(); once every slot is taken, new peers are only counted by purpose.
+ * Counting is a lookup and a few increments. It isn't safe from the WiFi callbacks, so the firmware only counts from
+ * loop(), once the callbacks have queued what they received or were told about a send.
+ *
+ * @tparam PURPOSES the number of purposes, type bytes 0 to PURPOSES - 1
+ * @tparam PEERS the number of peers tracked
+ */
+template <uint8_t PURPOSES, uint8_t PEERS>
+class LinkStats
+{
+public:
+  LinkStats()
+  {
+    reset();
+  }
+
+  /**
+   * @brief the counters for a purpose, or for purpose 0 if it's out of range
+   *
+   */
+  link_counters &purpose(uint8_t type)
+  {
+    return m_purposes[type < PURPOSES ? type : 0];
+  }
+
+  const link_counters &purpose(uint8_t type) const
+  {
+    return m_purposes[type < PURPOSES ? type : 0];
+  }
+
+  /**
+   * @brief the counters for a peer, given a slot if it's new
+   *
+   * @return NULL if it's new and every slot is taken
+   */
+  link_counters *peer(MacKey mac)
+  {
+    int index = m_peers.indexOf(mac);
+    if (index < 0)
+    {
+      if (m_peers.insert(mac) != PEER_ADDED)
+      {
+        return NULL;
+      }
+      index = m_peers.count() - 1;
+      m_peerCounters[index] = {};
+      m_successRates[index] = LINK_EWMA_ONE;
+    }
+    return &m_peerCounters[index];
+  }
+
+  /**
+   * @brief count an OnDataSent() result against a purpose and a peer, and move the peer's success rate towards it
+   *
+   */
+  void recordResult(uint8_t type, MacKey mac, boolean success)
+  {
+    link_counters &counters = purpose(type);
+    (success ? counters.txSuccess : counters.txFail)++;
+    link_counters *peerCounters = peer(mac);
+    if (peerCounters == NULL)
+    {
+      return;
+    }
+    (success ? peerCounters->txSuccess : peerCounters->txFail)++;
+    uint16_t &rate = m_successRates[peerCounters - m_peerCounters];
+    int32_t target = success ? LINK_EWMA_ONE : 0;
+    rate += (target - rate) / (1 << LINK_EWMA_SHIFT);
+  }
+
+  /**
+   * @brief the number of peers with counters
+   *
+   */
+  uint8_t peerCount() const
+  {
+    return m_peers.count();
+  }
+
+  /**
+   * @brief the address of the index-th peer with counters, in the order they were first seen
+   *
+   */
+  MacKey peerAt(uint8_t index) const
+  {
+    return m_peers.at(index);
+  }
+
+  const link_counters &peerCountersAt(uint8_t index) const
+  {
+    return m_peerCounters[index];
+  }
+
+  /**
+   * @brief the index-th peer's moving average delivery success rate, 0 to LINK_EWMA_ONE
+   *
+   */
+  uint16_t successRateAt(uint8_t index) const
+  {
+    return m_successRates[index];
+  }
+
+  /**
+   * @brief zero every counter and forget every peer
+   *
+   */
+  void reset()
+  {
+    for (uint8_t i = 0; i < PURPOSES; i++)
+    {
+      m_purposes[i] = {};
+    }
+    m_peers.clear();
+  }
+
+private:
+  link_counters m_purposes[PURPOSES];
+  PeerTable<PEERS> m_peers;
+  link_counters m_peerCounters[PEERS];
+  uint16_t m_successRates[PEERS];
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include "spscRing.h"
+#include "macKey.h"
+
+/**
+ * @brief one binary log record, formatted into text only when it's drained
+ *
+ * uint32_t time:
+ * millis() when the record was pushed
+ *
+ * uint8_t event:
+ * Which message to print, an index into the caller's table of messages
+ *
+ * uint8_t mac[6]:
+ * An optional mac address to print after the message, kept as bytes so a record stays 16 bytes
+ *
+ * int32_t value:
+ * An optional number to print after the message
+ *
+ */
+typedef struct log_entry
+{
+  uint32_t time;
+  uint8_t event;
+  uint8_t mac[6];
+  int32_t value;
+} log_entry;
+
+/**
+ * @brief an SpscRing of log_entry records, with a push() that stamps the time so callers only pass what to print
+ *
+ * @tparam SIZE the number of records, must be a power of two
+ */
+template <uint16_t SIZE>
+class LogRing : public SpscRing<log_entry, SIZE>
+{
+public:
+  /**
+   * @brief append a record, or count it as dropped if the ring is full
+   *
+   * @param event the message to print
+   * @param value a number to print with the message
+   * @param mac a mac address to print with the message
+   * @return false if the record was dropped
+   */
+  IRAM_ATTR bool push(uint8_t event, int32_t value = 0, MacKey mac = DUMMY_ADDRESS)
+  {
+    log_entry *entry = this->claim();
+    if (entry == NULL)
+    {
+      return false;
+    }
+    entry->time = millis();
+    entry->event = event;
+    entry->value = value;
+    mac.toBytes(entry->mac);
+    this->commit();
+    return true;
+  }
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief a mac address packed into the low 48 bits of a uint64_t, first byte most significant
+ *
+ * Comparing, copying and hashing an address are single word operations instead of loops over six bytes,
+ * and since the first byte is the most significant, < orders addresses the same way memcmp() would.
+ * Bytes only come back out at the edges: esp now calls, the wire format and printing.
+ *
+ */
+struct MacKey
+{
+  uint64_t value;
+
+  constexpr MacKey() : value(0) {}
+
+  constexpr explicit MacKey(uint64_t packed) : value(packed & 0xFFFFFFFFFFFFull) {}
+
+  /**
+   * @brief pack a six byte array, usable in constant expressions
+   *
+   */
+  constexpr MacKey(const uint8_t (&mac)[6])
+      : value((uint64_t)mac[0] << 40 | (uint64_t)mac[1] << 32 | (uint64_t)mac[2] << 24 |
+              (uint64_t)mac[3] << 16 | (uint64_t)mac[4] << 8 | (uint64_t)mac[5])
+  {
+  }
+
+  /**
+   * @brief pack six bytes from a pointer, such as the mac handed to the esp now callbacks
+   *
+   */
+  static MacKey fromBytes(const uint8_t *mac)
+  {
+    return MacKey(*(const uint8_t(*)[6])mac);
+  }
+
+  /**
+   * @brief unpack into six bytes, first byte first
+   *
+   */
+  void toBytes(uint8_t mac[6]) const
+  {
+    for (int i = 0; i < 6; i++)
+    {
+      mac[i] = (uint8_t)(value >> (40 - 8 * i));
+    }
+  }
+
+  /**
+   * @brief one byte of the address, 0 being the first
+   *
+   */
+  constexpr uint8_t byte(uint8_t index) const
+  {
+    return (uint8_t)(value >> (40 - 8 * index));
+  }
+
+  /**
+   * @brief a well mixed 32 bit hash, for hash tables and Bloom filters
+   *
+   */
+  constexpr uint32_t hash() const
+  {
+    return (uint32_t)((value * 0x9E3779B97F4A7C15ull) >> 32); // Fibonacci hashing, the high bits depend on every byte
+  }
+
+  constexpr bool operator==(const MacKey &other) const { return value == other.value; }
+  constexpr bool operator!=(const MacKey &other) const { return value != other.value; }
+  constexpr bool operator<(const MacKey &other) const { return value < other.value; }
+  constexpr bool operator>(const MacKey &other) const { return value > other.value; }
+};
+
+/**
+ * @brief address used for broadcasting via espnow
+ *
+ */
+static constexpr MacKey BROADCAST_ADDRESS(0xFFFFFFFFFFFFull);
+
+/**
+ * @brief a dummy address (all zeroes), used for "no address"
+ *
+ */
+static constexpr MacKey DUMMY_ADDRESS(0x000000000000ull);
+
+/**
+ * @brief a mac address as it's laid out on the wire: six bytes, no padding
+ *
+ * Message structs use this so they stay packed, and it converts to and from MacKey on assignment.
+ *
+ */
+typedef struct __attribute__((packed)) mac_bytes
+{
+  uint8_t bytes[6];
+
+  operator MacKey() const
+  {
+    return MacKey(bytes);
+  }
+
+  mac_bytes &operator=(const MacKey &key)
+  {
+    key.toBytes(bytes);
+    return *this;
+  }
+} mac_bytes;
+
+static_assert(sizeof(mac_bytes) == 6, "mac_bytes has to match the wire format");
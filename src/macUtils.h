@@ -1,9 +1,10 @@
+#include "macKey.h"
 
 /**
- * @brief variable to hold a dummy address (all zeroes)
+ * @brief variable to hold a dummy address (all zeroes), as bytes for the helpers below
  *
  */
-uint8_t DUMMY_ADDRESS[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+uint8_t DUMMY_ADDRESS_BYTES[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
 /**
  * @brief Print a mac address out to serial
@@ -19,33 +20,22 @@ void printMacAddress(uint8_t mac_addr[6])
 
 /**
  * @brief check if mac address are equal and return a boolean
- *  Runs through all 6 digits to check if each is equal
+ *  Packs both into a MacKey and compares them as one word
  *
  *
  */
 boolean areMacAddressesEqual(uint8_t first[6], uint8_t second[6])
 {
-    for (int i = 0; i < 6; i++)
-    {
-        if (first[i] != second[i])
-        {
-            return false;
-        }
-    }
-    return true;
+    return MacKey::fromBytes(first) == MacKey::fromBytes(second);
 }
 
 /**
  * @brief copy a mac address from param 2 to param 1
- * Runs through each digit and copies it
  *
  */
 void copyMacAddress(uint8_t dest[], uint8_t source[], int size = 6)
 {
-    for (int i = 0; i < size; i++)
-    {
-        dest[i] = source[i];
-    }
+    memcpy(dest, source, size);
 }
 
 /**
@@ -62,7 +52,7 @@ void printMacAddresses(uint8_t addressesToPrint[][6])
     Serial.println("Printing Peers:");
     for (unsigned int i = 0; i < sizeof(addressesToPrint) / sizeof(addressesToPrint[0]); i++)
     {
-        if (!areMacAddressesEqual(addressesToPrint[i], DUMMY_ADDRESS))
+        if (!areMacAddressesEqual(addressesToPrint[i], DUMMY_ADDRESS_BYTES))
         {
             Serial.print(i + 1);
             Serial.print(": ");
@@ -89,7 +79,7 @@ void pushNewMacAddress(uint8_t peerList[][6], uint8_t newAddress[6])
 {
     for (int i = 0; i < sizeof(peerList) / sizeof(peerList[0]); i++)
     {
-        if (areMacAddressesEqual(peerList[i], DUMMY_ADDRESS))
+        if (areMacAddressesEqual(peerList[i], DUMMY_ADDRESS_BYTES))
         {
             Serial.println("Copying...");
             for (int j = 0; j < 6; j++)
@@ -133,7 +123,7 @@ void removeAddressFromArray(uint8_t peerList[][6], int peerNumber)
         for (int i = peerNumber; i < maxAddresses; i++)
         {
             // If the current address isn't 0
-            if (!areMacAddressesEqual(peerList[i], DUMMY_ADDRESS))
+            if (!areMacAddressesEqual(peerList[i], DUMMY_ADDRESS_BYTES))
             {
                 // copy the current address into the previous (empty) address
                 for (int j = 0; j < 6; j++)
@@ -155,16 +145,16 @@ void removeAddressFromArray(uint8_t peerList[][6], int peerNumber)
     }
 }
 
+/**
+ * @brief qsort comparator for six byte mac addresses, in ascending MacKey order
+ *  The same lexicographic order PeerTable::insertSorted keeps, so two different addresses never compare equal
+ *
+ */
 int macAddressSorter(const void *cmp1, const void *cmp2)
 {
-    int a = 0;
-    int b = 0;
-    for (int i = 0; i < 6; i++)
-    {
-        a += ((uint8_t *)cmp1)[i];
-        b += ((uint8_t *)cmp2)[i];
-    }
-    return b - a;
+    MacKey a = MacKey::fromBytes((const uint8_t *)cmp1);
+    MacKey b = MacKey::fromBytes((const uint8_t *)cmp2);
+    return a < b ? -1 : a > b;
 }
 
 /**
@@ -177,7 +167,7 @@ int totalUsedAddressesInArray(uint8_t macAddressArray[][6])
     int syncedPeers = 0;
     for (int i = 0; i < sizeof(macAddressArray) / sizeof(macAddressArray[0]); i++)
     {
-        if (areMacAddressesEqual(macAddressArray[i], DUMMY_ADDRESS))
+        if (areMacAddressesEqual(macAddressArray[i], DUMMY_ADDRESS_BYTES))
         {
             syncedPeers = i;
             return i;
@@ -49,6 +49,27 @@ Yellow: ac:0b:fb:d7:b7:09
 #include <ESP8266WiFi.h>
 #include <espnow.h>
 #include <vector> // Needed for a dynamically-allocated peer array
+#include "logRing.h"
+#include "scheduler.h"
+#include "buttons.h"
+#include "macKey.h"
+#include "seqWindow.h"
+#include "peerTable.h"
+#include "bloomFilter.h"
+#include "timingStats.h"
+#include "linkStats.h"
+#include "traceBuffer.h"
+
+/**
+ * @brief declares a protocol timing constant: fixed on the dock, but a variable in the simulator so a parameter sweep
+ * can try other values without recompiling
+ *
+ */
+#ifdef GAMEDOCK_SIM
+#define TUNABLE static
+#else
+#define TUNABLE static const
+#endif
 
 /**
  * @brief PIN number of the sync button.
@@ -105,1034 +126,3271 @@ static const int ACTIVITY_LED = 5;
 static const int WIFI_CHANNEL = 1;
 
 /**
- * @brief variable to track sync button status, 0=unpressed
+ * @brief the index of each button in g_buttons, and the order their events are checked in
  *
+ */
+enum button_index : uint8_t
+{
+  BUTTON_SYNC,
+  BUTTON_PREV,
+  BUTTON_NEXT,
+  BUTTON_FLASH,
+  BUTTON_COUNT
+};
+
+/**
+ * @brief the debounced sync, previous, next and flash buttons
  *
  */
-int g_syncButtonState = 0;
+Buttons<BUTTON_COUNT> g_buttons;
 
 /**
- * @brief variable to track "previous" button status, 0=unpressed
+ * @brief a function that handles the button events of the current phase
  *
+ */
+typedef void (*button_handler)(const button_event &event);
+
+/**
+ * @brief the handler for the current phase's button events, NULL to ignore them
  *
  */
-int g_prevButtonState = 0;
+button_handler g_buttonHandler = NULL;
 
 /**
+ * @brief variable to track sync status, 0=off
  *
- * @brief variable to track when the previous button was last pressed down
  *
  */
-unsigned long g_prevStart = 0;
+int g_syncStarted = 0;
 
 /**
- * @brief variable to track "next" button status, 0=unpressed
+ * @brief variable to track time for syncing
  *
+ */
+unsigned long g_startSyncTime = 0;
+
+/**
+ * @brief variable used to determine whether the first player is being bothered (purpose 5)
  *
  */
-int g_nextButtonState = 0;
+int g_beingBothered = 0;
 
 /**
+ * @brief variable for holding this device's mac address, BROADCAST_ADDRESS and DUMMY_ADDRESS are constants in macKey.h
  *
- * @brief variable to track when the next  button was last pressed down
+ */
+MacKey OWN_MAC_ADDRESS;
+
+/**
+ * @brief variable for showing whether the peer list has been confirmed
  *
  */
-unsigned long g_nextStart = 0;
+int g_ownPeerListConfirmed = 0;
 
 /**
- * @brief flag to track whether action is still being taken from the current button press
+ * @brief the maximum number of peers we're willing to allow
  *
+ */
+static const int MAX_PEERS = 20;
+
+/**
+ * @brief the number of peers that have been synced
  *
  */
-// int g_button_pressed = 0;
+int g_syncedPeers = 0;
 
 /**
- * @brief variable to track sync status, 0=off
+ * @brief the synced peers, including this device, in ascending MacKey order until the turn order has been chosen
  *
  *
  */
-int g_syncStarted = 0;
+PeerTable<MAX_PEERS> g_peers;
 
 /**
- * @brief a variable to track whether all players have selected their turn order
+ * @brief the peers in the order they've chosen their turns, filled in from g_turnOrder by collectTurnOrder()
  *
  *
  */
-int g_allSelected = 0;
+PeerTable<MAX_PEERS> g_tempPeers;
 
 /**
- * @brief variable to track time for syncing
+ * @brief the peers that have chosen their turns, one bit each at their index in g_peers
  *
  */
-unsigned long g_startSyncTime = 0;
+uint32_t g_turnOrderChosen = 0;
 
 /**
- * @brief to show if the last broadcast was not sent
+ * @brief the g_peers index of each turn chosen so far, in the order they were chosen
+ *
+ * The number chosen is the popcount of g_turnOrderChosen, so the next choice is written there.
  *
  */
-int g_lastDeliveryFailed = -1;
+uint8_t g_turnOrder[MAX_PEERS];
 
 /**
- * @brief variable to store durations for pulseIn
+ * @brief turn orders heard before order selection started, registered by startOrderSelection()
+ *
+ * A dock that finishes catching up first can be choosing turns while we're still merging peers. Its TURN_ORDER was
+ * acked when it arrived, so it won't come again, and our g_peers indexes can still move, so the address is kept.
  *
  */
-unsigned long g_duration = 0;
+MacKey g_earlyTurnOrder[MAX_PEERS];
+uint8_t g_earlyTurnOrderCount = 0;
 
-unsigned long g_durationStart = 0;
-
-int g_newDurationAvailable = 1;
+static_assert(MAX_PEERS <= 32, "Every peer needs a bit in g_turnOrderChosen");
 
 /**
- * @brief variable used to determine whether the first player is being bothered (purpose 5)
+ * @brief true between sending our digest at the end of sync and choosing the first player
  *
  */
-int g_beingBothered = 0;
+boolean g_catchingUp = false;
 
 /**
- * @brief address used for broadcasting via espnow
+ * @brief the last digest each link peer sent during catch up, by link peer index
  *
  */
-uint8_t BROADCAST_ADDRESS[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+uint32_t g_linkPeerDigests[MAX_PEERS] = {0};
 
 /**
- * @brief variable for holding this device's mac address
+ * @brief the link peers that have sent a digest during catch up, one bit each
  *
  */
-uint8_t OWN_MAC_ADDRESS[6];
+uint32_t g_digestsHeard = 0;
 
 /**
- * @brief variable to hold a dummy address (all zeroes)
+ * @brief the current active player's mac address *
  *
  */
-uint8_t DUMMY_ADDRESS[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+MacKey g_currentPlayer = DUMMY_ADDRESS;
 
 /**
- * @brief variable for showing whether the peer list has been confirmed
+ * @brief a variable to hold the first player's address as soon as it's set
+ *
  *
  */
-int g_ownPeerListConfirmed = 0;
+MacKey g_firstPlayer = DUMMY_ADDRESS;
 
 /**
- * @brief the maximum number of peers we're willing to allow
+ * @brief the one-byte message types that start every frame, which must be matched on the receiving side.
+ *
+ * 1: I'm syncing and this is my MAC address
+ * 2: This is the list of peers that I have
+ * 3: I'm setting the current player
+ * 4: I'm registering my turn order
+ * 5: I'm poking the current player
+ * 6: This is the digest of the peers that I have
+ * 7: These are the peers you're missing, in reply to your list
+ * 8: Several of the above, one after another
  *
  */
-static const int MAX_PEERS = 20;
+enum message_type : uint8_t
+{
+  MSG_SYNCING = 1,
+  MSG_PEER_LIST = 2,
+  MSG_SET_PLAYER = 3,
+  MSG_TURN_ORDER = 4,
+  MSG_POKE = 5,
+  MSG_PEER_DIGEST = 6,
+  MSG_PEER_DELTA = 7,
+  MSG_BATCH = 8
+};
 
 /**
- * @brief the number of peers that have been synced
+ * @brief set in the type byte to indicate if this is being resent because of a reported sending failure.
  *
  */
-int g_syncedPeers = 0;
+static const uint8_t MSG_RESEND_FLAG = 0x80;
 
 /**
- * @brief a global array of peers
- *
+ * @brief mask to get the message_type back out of the type byte
  *
  */
-uint8_t g_peers[MAX_PEERS][6] = {0};
+static const uint8_t MSG_TYPE_MASK = 0x7F;
 
 /**
- * @brief a global array of peers used to reorder turns
- *
+ * @brief the most bytes esp now puts in one frame
  *
  */
-uint8_t g_tempPeers[MAX_PEERS][6] = {0};
+static const uint8_t ESPNOW_MAX_FRAME = 250;
 
 /**
- * @brief the current active player's mac address *
+ * @brief the two bytes that start every message
+ *
+ * uint8_t type:
+ * The message_type, with MSG_RESEND_FLAG set on retransmits
+ *
+ * uint8_t seq:
+ * The sender's sequence number for this message, the same on every retransmit of it
  *
  */
-uint8_t g_currentPlayer[6] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+typedef struct __attribute__((packed)) msg_header
+{
+  uint8_t type;
+  uint8_t seq;
+} msg_header;
 
 /**
- * @brief a variable to hold the first player's address as soon as it's set
+ * @brief purpose 4: the header and one mac address (8 bytes)
  *
+ * mac_bytes address:
+ * The address of the device registering its turn order
  *
  */
-uint8_t g_firstPlayer[6] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+typedef struct __attribute__((packed)) address_msg
+{
+  msg_header header;
+  mac_bytes address;
+} address_msg;
 
 /**
- * @brief a structure to send data, which must be matched on the receiving side.
+ * @brief the most peers a sync beacon passes on for the docks that seem to be missing them
  *
- * uint8_t address[6]:
- * The address that is currently being sent.
+ */
+static const uint8_t BEACON_GOSSIP_MAX = 4;
+
+/**
+ * @brief purpose 1: the sync beacon, with a summary of the peers the sender has heard (25 + 6 * count bytes)
  *
- * uint8_t peers[MAX_PEERS][6] = {0} :
- * A two dimensional array: 20 instances of 6 digit mac addresses.
+ * mac_bytes address:
+ * The address of the device that is syncing
  *
- * int indicator = 0
- * An indicator flag
- * Purpose 2: a flag for whether the peer list has been confirmed.
- * Purpose 3: the index number of the new current player
-
+ * BloomFilter<16> known:
+ * Every peer the sender has heard so far, so the docks that hear this can tell which ones it's missing
  *
- * int purpose:
- * 1: I'm syncing and this is my MAC address
- * 2: This is the list of peers that I have
- * 3: I'm setting the current player
- * 4: I'm registering my turn order
- * 5: I'm poking the current player
- * int resend = 0 to indicate if this is being resent because of a reported sending failure.
+ * mac_bytes peers[BEACON_GOSSIP_MAX]:
+ * Peers that some other dock's beacon didn't list, passed on so everyone hears about them within a round or two
  *
  */
-typedef struct autosync_send_struct
+typedef struct __attribute__((packed)) sync_beacon_msg
 {
-  int purpose;
-  uint8_t address[6];
-  uint8_t peers[MAX_PEERS][6] = {0};
-  int indicator = 0;
-  int resend = 0;
-} autosync_send_struct;
+  msg_header header;
+  mac_bytes address;
+  BloomFilter<16> known;
+  uint8_t count;
+  mac_bytes peers[BEACON_GOSSIP_MAX];
+} sync_beacon_msg;
 
-// Create a struct_message called sending to store variables to be sent
-autosync_send_struct sending = {0};
-
-// Create a struct_message called receiving
-autosync_send_struct lastSentPacket = {0};
+/**
+ * @brief peers to pass on in the next sync beacon, because a beacon we heard didn't list them
+ *
+ */
+MacKey g_gossip[BEACON_GOSSIP_MAX];
 
-/********************************************************************************************************************************************
- *                           Functions
- ********************************************************************************************************************************************/
+/**
+ * @brief the number of entries in g_gossip
+ *
+ */
+uint8_t g_gossipCount = 0;
 
 /**
- * @brief Print a mac address out to serial
+ * @brief purpose 2 and 7: the header, a peer count, and only the peers that are actually used (3 + 6 * count bytes)
+ *
+ * uint8_t count:
+ * The number of entries in peers that are on the wire, never more than MAX_PEERS
  *
  */
-void printMacAddress(uint8_t mac_addr[6])
+typedef struct __attribute__((packed)) peer_list_msg
 {
-  char macStr[18];
-  snprintf(macStr, sizeof(macStr), "%02x:%02x:%02x:%02x:%02x:%02x",
-           mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
-  Serial.print(macStr);
-}
+  msg_header header;
+  uint8_t count;
+  mac_bytes peers[MAX_PEERS];
+} peer_list_msg;
 
 /**
- * @brief check if mac address are equal and return a boolean
- *  Runs through all 6 digits to check if each is equal
- *
+ * @brief purpose 3: the header, the index number of the new current player and its address (9 bytes)
  *
  */
-boolean areMacAddressesEqual(uint8_t first[6], uint8_t second[6])
+typedef struct __attribute__((packed)) set_player_msg
 {
-  for (int i = 0; i < 6; i++)
-  {
-    if (first[i] != second[i])
-    {
-      return false;
-    }
-  }
-  return true;
-}
+  msg_header header;
+  int8_t indicator;
+  mac_bytes address;
+} set_player_msg;
 
 /**
- * @brief send a gamedock_send_struct to all peers
- * Depends on printMacAddress
+ * @brief purpose 6: the header, how many peers the sender has and PeerTable::digest() of them (7 bytes)
  *
+ * Sent instead of the whole peer list at the end of sync. Lists only go out to the docks whose digest is different.
  *
  */
-autosync_send_struct sendPacket(autosync_send_struct toSend)
+typedef struct __attribute__((packed)) peer_digest_msg
 {
-  // Send message via ESP-NOW
-  Serial.print("Message sending: command: ");
-  Serial.println(toSend.purpose);
-  Serial.println("Sending Mac: ");
-  printMacAddress(toSend.address);
-  Serial.println();
-  Serial.print("Send result: ");
-  Serial.println(esp_now_send(0, (uint8_t *)&toSend, sizeof(toSend)));
-  return toSend; // return this to be used again in case of failure
-}
+  msg_header header;
+  uint8_t count;
+  uint32_t digest;
+} peer_digest_msg;
 
 /**
- * @brief copy a mac address from param 2 to param 1
- * Runs through each digit and copies it
+ * @brief a packet to send (or resend), holding whichever message is in it and how many of its bytes go on the wire
+ *
+ * Purpose 5 is only the header (2 bytes).
  *
  */
-void copyMacAddress(uint8_t dest[], uint8_t source[], int size = 6)
+typedef struct autosync_packet
 {
-  for (int i = 0; i < size; i++)
+  uint8_t length;
+  union
   {
-    dest[i] = source[i];
-  }
-}
+    msg_header header;
+    address_msg addressMsg;
+    sync_beacon_msg syncBeaconMsg;
+    peer_list_msg peerListMsg;
+    set_player_msg setPlayerMsg;
+    peer_digest_msg peerDigestMsg;
+    uint8_t bytes[sizeof(peer_list_msg)];
+  };
+} autosync_packet;
 
 /**
- * @brief print a list of peers from a two dimensional array that must be as long as MAX_PEERS
- *  Depends on areMacAddressesEqual and printMacAddress
+ * @brief purpose 8: the header, then messages that were queued together, each preceded by its length in one byte
  *
- *  This iterates through an entire peers list and prints each peer until it comes to one that is all zeroes
+ * Each message keeps its own header, so it's handled exactly as if it had come in a frame of its own, in the order
+ * they were queued. The batch's own sequence number is the first message's, so the frame can be matched in a trace.
+ * Batches are never nested, and a message on its own is never wrapped in one.
  *
  */
-void printPeers(uint8_t peersToPrint[MAX_PEERS][6])
+typedef struct __attribute__((packed)) batch_msg
 {
-  Serial.println("Printing Peers:");
-  for (unsigned int i = 0; i < MAX_PEERS; i++)
-  {
-    if (!areMacAddressesEqual(peersToPrint[i], DUMMY_ADDRESS))
-    {
-      Serial.print(i + 1);
-      Serial.print(": ");
-      printMacAddress(peersToPrint[i]);
-      Serial.println();
-    }
-    else
-    {
-      break;
-    }
-  }
-}
+  msg_header header;
+  uint8_t records[ESPNOW_MAX_FRAME - sizeof(msg_header)];
+} batch_msg;
 
 /**
- * @brief an interrupt function to track how long the sync button has been held down
+ * @brief the number of bytes a peer list message takes on the wire
  *
+ * @param count the number of peers in the list
  */
-IRAM_ATTR void syncInterrupt()
+static inline uint8_t peerListMsgSize(uint8_t count)
 {
-  if (digitalRead(SYNC_BUTTON) == HIGH)
-  {
-    Serial.println("Duration start");
-    g_durationStart = millis();
-    g_duration = 0;
-  }
-  else
-  {
-    Serial.println("Duration end");
-    g_duration = millis() - g_durationStart;
-    g_durationStart = 0;
-    g_newDurationAvailable = 1;
-  }
+  return offsetof(peer_list_msg, peers) + count * 6;
 }
 
 /**
- * @brief push a new peer onto the g_peers array
- * Depends on areMacAddresseEqual
- *
- * Iterates through the global g_peers to push a new peer onto the first slot that is all zeroes
+ * @brief the number of bytes a sync beacon takes on the wire
  *
+ * @param count the number of peers passed on in it
  */
-void pushNewPeer(uint8_t newPeer[6])
+static inline uint8_t syncBeaconMsgSize(uint8_t count)
 {
-  for (int i = 0; i < MAX_PEERS; i++)
-  {
-    if (areMacAddressesEqual(g_peers[i], DUMMY_ADDRESS))
-    {
-      Serial.println("Copying...");
-      for (int j = 0; j < 6; j++)
-      {
-        g_peers[i][j] = newPeer[j];
-        Serial.print(newPeer[j]);
-        Serial.print(":");
-      }
-      Serial.println("");
-      break;
-    }
-  }
+  return offsetof(sync_beacon_msg, peers) + count * 6;
 }
 
 /**
- * @brief remove a peer, then move subsequent array items forward to prevent empty spaces
- * Depends on areMacAddressesEqual
- *
- * @param peerNumber the index from which to remove an item, cannot be higher than MAX_PEERS - 1
+ * @brief check that a received frame is exactly as long as its type says it should be
  *
+ * Frames that are short, too long, or of an unknown type are rejected so that nothing is read past their end.
+ * A batch has to be filled exactly by its messages, and every one of them has to be valid.
  *
+ * @param incomingData the raw frame
+ * @param len the number of bytes received
  */
-void removeAddressFromArray(int peerNumber)
+boolean isValidMessage(const uint8_t *incomingData, uint8_t len)
 {
-  if (peerNumber > MAX_PEERS - 1)
+  if (len < sizeof(msg_header))
   {
-    Serial.print("****WARNING! PEER NOT REMOVED! PARAMETER TOO HIGH: ");
-    Serial.println(peerNumber);
+    return false;
   }
-  else
+  switch (incomingData[0] & MSG_TYPE_MASK)
   {
-    // Remove the identified peer
-    for (int i = 0; i < 6; i++)
-    {
-      g_peers[peerNumber][i] = 0x00;
-    }
-    // Look at the next peer
-    peerNumber++;
-    // Iterate through the remaining peers (if it was 19, it won't interate)
-    for (int i = peerNumber; i < MAX_PEERS; i++)
+  case MSG_SYNCING:
+    return len >= offsetof(sync_beacon_msg, peers) &&
+           incomingData[offsetof(sync_beacon_msg, count)] <= BEACON_GOSSIP_MAX &&
+           len == syncBeaconMsgSize(incomingData[offsetof(sync_beacon_msg, count)]);
+  case MSG_TURN_ORDER:
+    return len == sizeof(address_msg);
+  case MSG_PEER_LIST:
+  case MSG_PEER_DELTA:
+    return len >= offsetof(peer_list_msg, peers) &&
+           incomingData[offsetof(peer_list_msg, count)] <= MAX_PEERS &&
+           len == peerListMsgSize(incomingData[offsetof(peer_list_msg, count)]);
+  case MSG_SET_PLAYER:
+    return len == sizeof(set_player_msg);
+  case MSG_POKE:
+    return len == sizeof(msg_header);
+  case MSG_PEER_DIGEST:
+    return len == sizeof(peer_digest_msg);
+  case MSG_BATCH:
+  {
+    uint8_t offset = sizeof(msg_header);
+    while (offset < len)
     {
-      // If the current address isn't 0
-      if (!areMacAddressesEqual(g_peers[i], DUMMY_ADDRESS))
-      {
-        // copy the current address into the previous (empty) address
-        for (int j = 0; j < 6; j++)
-        {
-          g_peers[i - 1][j] = g_peers[i][j];
-        }
-        // empty the current address
-        for (int j = 0; j < 6; j++)
-        {
-          g_peers[i + 1][j] = 0x00;
-        }
-      }
-      else
+      uint8_t length = incomingData[offset++];
+      if (length > len - offset || length == 0 || (incomingData[offset] & MSG_TYPE_MASK) == MSG_BATCH ||
+          !isValidMessage(incomingData + offset, length))
       {
-        // if the next address was 0, we've reached the end of non-empty addresses
-        break;
+        return false;
       }
+      offset += length;
     }
+    return offset > sizeof(msg_header);
   }
-}
-
-/********************************************************************************************************************************************
- *                           Send Failure Catchall
- ********************************************************************************************************************************************/
-void checkFailure()
-{
-  if (g_lastDeliveryFailed == 1) // If a send failure was detected, stop execution for 50ms and resend
-  {
-    delay(50);
-    g_lastDeliveryFailed = 0; // Reset variable to indicate the failure was noticed
-    lastSentPacket.resend = 1;
-    sendPacket(lastSentPacket);
+  default:
+    return false;
   }
 }
 
 /**
- * @brief check an incoming address against the global list of peers to see if it's new, and if so, add it to the list.
- *  Depends on areMacAddressesEqual and pushNewPeer
+ * @brief the sequence numbers already received from each dock, so retransmits are only handled once
  *
- *  @param incomingAddress a gamedock_send_struct to check
+ */
+DuplicateFilter<MAX_PEERS> g_seenFrames;
+
+/**
+ * @brief the events the firmware logs
  *
+ * Each one is an index into LOG_MESSAGES, which says how to print it when the log is drained in loop()
  *
  */
-void checkAndSyncAddress(autosync_send_struct incomingAddress)
+enum log_event : uint8_t
 {
-  int duplicatePeer = 0;                                             // Initialize a duplicate indicator
-  if (!areMacAddressesEqual(DUMMY_ADDRESS, incomingAddress.address)) // If the incoming address isn't zeroes
-  {
-    for (int i = 0; i < MAX_PEERS; i++) // iterate over the array of peers
-    {
-      if (areMacAddressesEqual(g_peers[i], DUMMY_ADDRESS)) // if the end of the peers array has been reached, stop
-      {
-        break;
-      }
-      else
-      {
-        if (areMacAddressesEqual(g_peers[i], incomingAddress.address)) // check each el_peer to see if its address is the incoming address
-        {
-          duplicatePeer = 1; // if it's duplicate, set duplicate to 1 (true)
-          break;             // no need to keep searching, we know it's a duplicate
-        }
-      }
-    }
-    if (duplicatePeer == 0) // after iterating, if no duplicate was detected
-    {
-      pushNewPeer(incomingAddress.address); // push it to the array
-    }
-  }
-  else
-  {
-    Serial.println("Found a dummy address while checking and syncing");
-  }
-}
+  LOG_DELIVERY_SUCCESS,
+  LOG_DELIVERY_FAIL,
+  LOG_RECEIVING,
+  LOG_MALFORMED_FRAME,
+  LOG_PURPOSE_RECEIVED,
+  LOG_RESEND_RECEIVED,
+  LOG_SYNC_STARTED,
+  LOG_DUMMY_ADDRESS,
+  LOG_NEW_PEER,
+  LOG_DUPLICATE_PEER,
+  LOG_BROADCAST_RECEIVED,
+  LOG_MY_MAC_INCLUDED,
+  LOG_PEER_LIST_CONFIRMED,
+  LOG_PEERS_ADDED,
+  LOG_PEERS_SETTLED,
+  LOG_PEER,
+  LOG_CURRENT_PLAYER,
+  LOG_NOT_CURRENT_PLAYER,
+  LOG_TURN_ORDER_REGISTERED,
+  LOG_TURN_ORDER_DUPLICATE,
+  LOG_TURN_ORDER_UNKNOWN,
+  LOG_TURN_ORDER_EARLY,
+  LOG_BUTTON_PRESSED,
+  LOG_BUTTON_RELEASED,
+  LOG_BUTTON_HELD,
+  LOG_SEND_ERROR,
+  LOG_TX_RETRY,
+  LOG_TX_GAVE_UP,
+  LOG_TX_QUEUE_FULL,
+  LOG_TX_SUPERSEDED,
+  LOG_DUPLICATE_FRAME,
+  LOG_STALE_FRAME,
+  LOG_DIGEST_MATCHED,
+  LOG_DIGEST_DIFFERENT,
+  LOG_PEERS_CONVERGED,
+  LOG_GOSSIP_QUEUED,
+  LOG_EVENT_COUNT
+};
 
 /**
- * @brief Send this device's mac address to the broadcast peer
- * Depends on copyMacAddress and sendPacket
+ * @brief flags for whether a log_event is printed with its value and/or its mac address
  *
  */
-void sendMacAddress()
+static const uint8_t LOG_WITH_VALUE = 1;
+static const uint8_t LOG_WITH_MAC = 2;
+
+/**
+ * @brief the text of each log_event and what to print after it
+ *
+ */
+typedef struct log_message
 {
-  autosync_send_struct sending = {0};               // Create a packet to send
-  sending.purpose = 1;                              // set purpose to 1 = I'm syncing and this is my Mac address
-  copyMacAddress(sending.address, OWN_MAC_ADDRESS); // Include the mac address of this device.
-  lastSentPacket = sendPacket(sending);             // Send the packet
-}
+  const char *text;
+  uint8_t flags;
+} log_message;
+
+static const log_message LOG_MESSAGES[] = {
+    {"Delivery success to ", LOG_WITH_MAC},
+    {"Delivery fail to ", LOG_WITH_MAC},
+    {"Bytes received: ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Malformed frame dropped, bytes: ", LOG_WITH_VALUE},
+    {"Purpose received: ", LOG_WITH_VALUE},
+    {"Resend received", 0},
+    {"SyncStarted: ", LOG_WITH_VALUE},
+    {"Found a dummy address while checking and syncing", 0},
+    {"New peer: ", LOG_WITH_MAC},
+    {"Duplicate peer: ", LOG_WITH_MAC},
+    {"Broadcast address received", 0},
+    {"My mac included? ", LOG_WITH_VALUE},
+    {"Peer List Confirmed!", 0},
+    {"New peer(s) added: ", LOG_WITH_VALUE},
+    {"Peers are settled, ignored the peers from ", LOG_WITH_MAC},
+    {"Peer ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"I am the current player: ", LOG_WITH_MAC},
+    {"I am not the current player, current player is: ", LOG_WITH_MAC},
+    {"Registered turn order at index ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Turn order was a duplicate at index ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Turn order from a dock that didn't sync: ", LOG_WITH_MAC},
+    {"Turn order before order selection, kept until then: ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Button pressed: ", LOG_WITH_VALUE},
+    {"Button released after ms: ", LOG_WITH_VALUE},
+    {"Button held for ms: ", LOG_WITH_VALUE},
+    {"esp_now_send failed with: ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Retransmitting seq: ", LOG_WITH_VALUE},
+    {"****WARNING! GAVE UP SENDING seq: ", LOG_WITH_VALUE},
+    {"****WARNING! TRANSMIT QUEUE FULL, DROPPED purpose: ", LOG_WITH_VALUE},
+    {"Superseded by a newer message, seq: ", LOG_WITH_VALUE},
+    {"Duplicate frame dropped, seq: ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Stale frame dropped, seq: ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Peer digest matches from ", LOG_WITH_MAC},
+    {"Peer digest differs, their count: ", LOG_WITH_VALUE | LOG_WITH_MAC},
+    {"Every peer's digest matches, peers: ", LOG_WITH_VALUE},
+    {"Passing on a peer a beacon didn't list: ", LOG_WITH_MAC},
+};
+static_assert(sizeof(LOG_MESSAGES) / sizeof(LOG_MESSAGES[0]) == LOG_EVENT_COUNT, "Every log_event needs a message");
 
 /**
- * @brief Remove the BROADCAST_ADDRESS from the esp now peer list and adds all peers in the peers global
+ * @brief log written and drained to Serial by loop()
  *
+ * Only loop() and what it calls push here. The WiFi callbacks hand everything to loop() through g_rxFrames and
+ * g_txResults, and the button interrupts through g_buttons, so none of them log.
  *
  */
-void switchFromBroadcastToPeers()
-{
-  esp_now_del_peer(BROADCAST_ADDRESS); // Remove the broadcast address
-  for (int i = 0; i < MAX_PEERS; i++)
-  {
-    if (!areMacAddressesEqual(g_peers[i], DUMMY_ADDRESS) && !areMacAddressesEqual(g_peers[i], OWN_MAC_ADDRESS)) // if the current peer is not empty and not this device
-    {
-      esp_now_add_peer(g_peers[i], ESP_NOW_ROLE_COMBO, WIFI_CHANNEL, NULL, 0); // add the current peer
-    }
-    else
-    {
-      break; // otherwise we're done
-    }
-  }
-}
+LogRing<64> g_log;
 
 /**
- * @brief Remove the peers in the peers global from the esp now peer list and adds the BROADCAST_ADDRESS
+ * @brief the number of dropped log entries that have already been reported
  *
+ */
+uint32_t g_reportedLogDrops = 0;
+
+/**
+ * @brief the longest frame worth keeping, a full batch
  *
  */
-void switchFromPeersToBroadcast()
-{
-  for (int i = 0; i < MAX_PEERS; i++)
-  {
-    if (!areMacAddressesEqual(g_peers[i], DUMMY_ADDRESS)) // if the current peer is not empty
-    {
-      esp_now_del_peer(g_peers[i]); // delete it from the list
-    }
-    else
-    {
-      break; // otherwise we're done
-    }
-  }
-  esp_now_add_peer(BROADCAST_ADDRESS, ESP_NOW_ROLE_COMBO, WIFI_CHANNEL, NULL, 0);
-}
+static const uint8_t RX_FRAME_BYTES = ESPNOW_MAX_FRAME;
 
-void copyPeers(uint8_t dest[MAX_PEERS][6], uint8_t source[MAX_PEERS][6])
+/**
+ * @brief a frame as OnDataRecvd() got it, waiting in g_rxFrames to be handled in loop()
+ *
+ * uint32_t time:
+ * micros() when it arrived, for the trace
+ *
+ * uint8_t mac[6]:
+ * The sender's address
+ *
+ * uint8_t length:
+ * Its length on the wire. Only the first RX_FRAME_BYTES are kept, so a longer frame fails isValidMessage()
+ *
+ */
+typedef struct rx_frame
 {
-  for (int i = 0; i < MAX_PEERS; i++)
-  {
-    for (int j = 0; j < 6; j++)
-    {
-      dest[i][j] = source[i][j];
-    }
-  }
-}
+  uint32_t time;
+  uint8_t mac[6];
+  uint8_t length;
+  uint8_t data[RX_FRAME_BYTES];
+} rx_frame;
 
 /**
- * @brief Send the list of peers out to all currently registered peers
+ * @brief the number of frames that can arrive between two passes through loop(), about 4KB
+ *
+ * A pass is normally well under a millisecond, and even twenty docks all beaconing at the fastest rate during sync is
+ * only a frame every 5ms, so the ring only fills when loop() is held up.
  *
  */
-void confirmSync()
-{
-  Serial.println("Confirming sync..."); // logging
-  delay(100);
-  autosync_send_struct sending = {0}; // Create a packet to send
-  copyPeers(sending.peers, g_peers);  // Attach the full list of peers
-  sending.indicator = 0;
-  copyMacAddress(sending.address, DUMMY_ADDRESS); // Send a dummy address
-  sending.purpose = 2;                            // 2: this is the list of peers I have
-  Serial.println("Confirming Sync:");
-  Serial.print("Mac: ");
-  printMacAddress(sending.address); // Todo: What the heck address is being sent??
-  Serial.println();
-  Serial.print("Peer list confirmed: ");
-  Serial.println(sending.indicator);
-  Serial.print("Purpose: ");
-  Serial.println(sending.purpose);
-  Serial.print("Resend: ");
-  Serial.println(sending.resend);
-  Serial.print("Peers to send: ");
-  printPeers(sending.peers);
-  Serial.println("");
-  lastSentPacket = sendPacket(sending); // Send the packet
-  Serial.println("Local peers:");
-  printPeers(g_peers);
-}
+static const uint16_t RX_QUEUE_SIZE = 16;
 
 /**
- * @brief Given a struct with a peers parameter, push it to the global peers vector if it's new
+ * @brief frames received by OnDataRecvd() and handled by loop(), so the callback never touches the game state
  *
+ */
+SpscRing<rx_frame, RX_QUEUE_SIZE> g_rxFrames;
+
+/**
+ * @brief the number of dropped frames that have already been reported
  *
  */
-void confirmPeerList(autosync_send_struct incomingPeers)
-{
-  int peerListChanged = 0;            // initialize an indicator for whether the peer list has changed
-  int myMacIncluded = 0;              // initialize an indicator for whether the current device's mac address is in the peer list
-  for (int i = 0; i < MAX_PEERS; i++) // Loop through the incoming peers
-  {
-    Serial.println("Checking MAC addresses:"); // Logging
-    printMacAddress(incomingPeers.peers[i]);   // Logging
-    Serial.println();                          // Logging
-    if (!areMacAddressesEqual(incomingPeers.peers[i], DUMMY_ADDRESS))
-    {
-      if (!areMacAddressesEqual(incomingPeers.peers[i], BROADCAST_ADDRESS))
-      {
-        if (areMacAddressesEqual(incomingPeers.peers[i], OWN_MAC_ADDRESS))
-        {
-          myMacIncluded = 1;
-        }
-        int duplicateFound = 0;
-        for (int j = 0; j < MAX_PEERS; j++) // for each incoming peer, loop through the local list of peers
-        {
-          if (!areMacAddressesEqual(g_peers[j], DUMMY_ADDRESS))
-          {
-            if (areMacAddressesEqual(g_peers[j], incomingPeers.peers[i]))
-            {
-              Serial.println("^ duplicate"); // logging
-              duplicateFound = 1;            // A duplicate was found
-              break;                         // if so, no need to further analyze, move on to the next address
-            }
-          }
-          else
-          {
-            break; // The end was found, stop iterating
-          }
-        }
-        if (duplicateFound == 0) // after iterating, if this is not a duplicate, push it to the global peers list
-        {
-          pushNewPeer(incomingPeers.peers[i]);
-          Serial.println("^ new"); // logging
-          peerListChanged++;       // A duplicate was not found on this, the peer list was changed
-        }
-      }
-      else
-      {
-        Serial.println("Broadcast address received");
-      }
-    }
-    else
-    {
-      Serial.println("Last address");
-      break;
-    }
-  }
-  Serial.print("My mac included? ");
-  Serial.println(myMacIncluded);
-  if (myMacIncluded == 0)
-  {
-    pushNewPeer(OWN_MAC_ADDRESS);
-    peerListChanged++;
-  }
-  if (peerListChanged == 0)
-  {
-    Serial.println("Peer List Confirmed!");
-  }
-  else
-  {
-    Serial.print(peerListChanged);
-    Serial.println(" new peer(s) added");
-  }
-  printPeers(g_peers);
-  Serial.println("");
-}
+uint32_t g_reportedRxDrops = 0;
 
-int setSyncedPeers()
+/**
+ * @brief the phase loop() is in, so each pass through it is timed against the right phase
+ *
+ */
+enum loop_phase : uint8_t
 {
-  for (int i = 0; i < MAX_PEERS; i++)
-  {
-    if (areMacAddressesEqual(g_peers[i], DUMMY_ADDRESS))
-    {
-      g_syncedPeers = i;
-      return i;
-    }
-  }
-  return g_syncedPeers;
-}
+  PHASE_SYNC,
+  PHASE_CATCH_UP,
+  PHASE_FIRST_PLAYER,
+  PHASE_ORDER,
+  PHASE_WAIT_ALL,
+  PHASE_TURNS
+};
 
-int macAddressSorter(const void *cmp1, const void *cmp2)
+/**
+ * @brief every timer in g_timings
+ *
+ * Each one is an index into TIMING_NAMES, the purpose handlers are in purpose order and the loop() phases are in
+ * loop_phase order so both can be picked by adding to the first one.
+ *
+ */
+enum timing_id : uint8_t
 {
-  int a = 0;
-  int b = 0;
-  for (int i = 0; i < 6; i++)
-  {
-    a += ((uint8_t *)cmp1)[i];
-    b += ((uint8_t *)cmp2)[i];
-  }
-  return b - a;
-}
+  TIMING_ON_DATA_RECVD,
+  TIMING_ON_DATA_SENT,
+  TIMING_HANDLE_FRAME,
+  TIMING_HANDLE_SYNCING,
+  TIMING_HANDLE_PEER_LIST,
+  TIMING_HANDLE_SET_PLAYER,
+  TIMING_HANDLE_TURN_ORDER,
+  TIMING_HANDLE_POKE,
+  TIMING_HANDLE_PEER_DIGEST,
+  TIMING_HANDLE_PEER_DELTA,
+  TIMING_PASS_TURN,
+  TIMING_LOOP_SYNC,
+  TIMING_LOOP_CATCH_UP,
+  TIMING_LOOP_FIRST_PLAYER,
+  TIMING_LOOP_ORDER,
+  TIMING_LOOP_WAIT_ALL,
+  TIMING_LOOP_TURNS,
+  TIMING_COUNT
+};
+
+static_assert(TIMING_HANDLE_PEER_DELTA - TIMING_HANDLE_SYNCING == MSG_PEER_DELTA - MSG_SYNCING,
+              "Every purpose needs a handler timer, in purpose order");
+static_assert(TIMING_LOOP_TURNS - TIMING_LOOP_SYNC == PHASE_TURNS - PHASE_SYNC,
+              "Every loop_phase needs a loop() timer, in phase order");
+
+static const char *const TIMING_NAMES[] = {
+    "OnDataRecvd",
+    "OnDataSent",
+    "handleFrame",
+    "purpose 1 syncing",
+    "purpose 2 peer list",
+    "purpose 3 set player",
+    "purpose 4 turn order",
+    "purpose 5 poke",
+    "purpose 6 peer digest",
+    "purpose 7 peer delta",
+    "passTurn",
+    "loop sync",
+    "loop catch up",
+    "loop first player",
+    "loop order selection",
+    "loop wait all selected",
+    "loop take turns",
+};
+static_assert(sizeof(TIMING_NAMES) / sizeof(TIMING_NAMES[0]) == TIMING_COUNT, "Every timing_id needs a name");
 
-void sortMacAddressArrayList()
-{
-  g_syncedPeers = setSyncedPeers();
-  Serial.print("Peers synced: ");
-  Serial.println(g_syncedPeers);
-  qsort(g_peers, g_syncedPeers, sizeof(g_peers[0]), macAddressSorter);
+/**
+ * @brief min/max/mean times of the callbacks, handling a received frame, the purpose handlers, passTurn() and each
+ * phase's passes through loop()
+ *
+ */
+TimingStats<TIMING_COUNT> g_timings;
+
+/**
+ * @brief the phase loop() is in, set when each phase starts
+ *
+ */
+loop_phase g_loopPhase = PHASE_SYNC;
+
+/**
+ * @brief the next row of g_timings to print for the stats command, -1 if it isn't printing
+ *
+ */
+int8_t g_timingRow = -1;
+
+/**
+ * @brief how many peers get their own link counters: every player, the broadcast address and a few strangers
+ *
+ */
+static const uint8_t LINK_STATS_PEERS = MAX_PEERS + 4;
+
+/**
+ * @brief frames sent, received, delivered, failed, retransmitted and dropped as duplicates, by purpose and by peer
+ *
+ */
+LinkStats<MSG_PEER_DELTA + 1, LINK_STATS_PEERS> g_linkStats;
+
+/**
+ * @brief the next row of g_linkStats to print for the links command, -1 if it isn't printing
+ *
+ */
+int8_t g_linkRow = -1;
+
+/**
+ * @brief every event in g_trace, each an index into TRACE_NAMES
+ *
+ * What arg and value hold for each:
+ * TRACE_BUTTON: the button and the button_event type
+ * TRACE_TRANSMIT: a span around each esp_now_send() of a message, the type byte and the sequence number
+ * TRACE_TX_RESULT: the moment OnDataSent() queued a result, the status and the low 32 bits of the peer's address
+ * TRACE_RECEIVE: the moment OnDataRecvd() queued a frame, the length and the low 32 bits of the sender's address
+ * TRACE_DISPATCH: a span around a purpose handler, the type byte, and the low 24 bits of the sender's address
+ * shifted up by 8 with the sequence number in the bottom 8, so the frame can be matched to the sender's TRACE_TRANSMIT
+ * TRACE_PASS_TURN: a span around passTurn(), its player parameter
+ * TRACE_CURRENT_PLAYER: the low 32 bits of the current player's address, whenever it's checked against this device's
+ * TRACE_PHASE: the loop_phase that just started
+ * TRACE_LED: the pin and the level written to it
+ *
+ */
+enum trace_event : uint8_t
+{
+  TRACE_BUTTON,
+  TRACE_TRANSMIT,
+  TRACE_TX_RESULT,
+  TRACE_RECEIVE,
+  TRACE_DISPATCH,
+  TRACE_PASS_TURN,
+  TRACE_CURRENT_PLAYER,
+  TRACE_PHASE,
+  TRACE_LED,
+  TRACE_EVENT_COUNT
+};
+
+static const char *const TRACE_NAMES[] = {
+    "button",
+    "transmit",
+    "tx result",
+    "receive",
+    "dispatch",
+    "passTurn",
+    "current player",
+    "phase",
+    "led",
+};
+static_assert(sizeof(TRACE_NAMES) / sizeof(TRACE_NAMES[0]) == TRACE_EVENT_COUNT, "Every trace_event needs a name");
+
+/**
+ * @brief the last few seconds of sends, receives, dispatches, phase changes and LED changes, for the trace command
+ *
+ */
+TraceBuffer<256> g_trace;
+
+/**
+ * @brief the next record of g_trace to print for the trace command, -1 if it isn't printing
+ *
+ */
+int16_t g_traceRow = -1;
+
+/**
+ * @brief the serial command being typed, up to the newline that runs it
+ *
+ */
+char g_serialCommand[24];
+uint8_t g_serialCommandLength = 0;
+
+/**
+ * @brief the sync beacon interval when the sync button is first pressed
+ *
+ */
+TUNABLE uint32_t SYNC_BEACON_START_MS = 200;
+
+/**
+ * @brief the shortest and longest the sync beacon interval adapts to
+ *
+ */
+TUNABLE uint32_t SYNC_BEACON_MIN_MS = 100;
+TUNABLE uint32_t SYNC_BEACON_MAX_MS = 1000;
+
+/**
+ * @brief how much the shortest beacon interval grows for each peer heard, so the whole table's beacons stay spread out
+ *
+ */
+TUNABLE uint32_t SYNC_BEACON_MS_PER_PEER = 20;
+
+/**
+ * @brief how long to keep listening for other peer lists after sending ours at the end of sync
+ *
+ */
+TUNABLE uint32_t CATCH_UP_MS = 3000;
+
+/**
+ * @brief how long the sync button has to be held down while taking turns to restart
+ *
+ */
+TUNABLE uint32_t RESTART_HOLD_MS = 3000;
+
+/**
+ * @brief how long both buttons have to be held down before poking the current player, and how often to poke
+ *
+ */
+static const uint32_t BOTHER_HOLD_MS = 3000;
+static const uint32_t BOTHER_INTERVAL_MS = 500;
+
+/**
+ * @brief how often order selection checks whether it can move on without a button press
+ *
+ */
+static const uint32_t ORDER_POLL_MS = 5;
+
+/**
+ * @brief the cooperative scheduler that runs every phase of loop()
+ *
+ */
+Scheduler<12> g_scheduler;
+
+/**
+ * @brief the task polling for the end of the current phase, -1 if none
+ *
+ */
+int8_t g_phaseTask = -1;
+
+/**
+ * @brief the task running the LED pattern of the current phase, -1 if none
+ *
+ */
+int8_t g_blinkTask = -1;
+
+/**
+ * @brief the task broadcasting this device's mac address during sync, -1 if none
+ *
+ */
+int8_t g_beaconTask = -1;
+
+/**
+ * @brief the current sync beacon interval before jitter, adapted after every beacon by nextBeaconDelay()
+ *
+ */
+uint32_t g_beaconIntervalMs = SYNC_BEACON_START_MS;
+
+/**
+ * @brief g_deliveryFailures when the last beacon was sent
+ *
+ */
+uint32_t g_beaconFailuresSeen = 0;
+
+/**
+ * @brief the beacons heard from other docks since the last one we sent, and millis() when we sent it
+ *
+ */
+uint16_t g_beaconsHeard = 0;
+uint32_t g_lastBeaconAt = 0;
+
+/**
+ * @brief the number of blinks the current LED pattern has done
+ *
+ */
+uint8_t g_blinkCount = 0;
+
+/**
+ * @brief the last state written to the LED the current pattern is toggling
+ *
+ */
+uint8_t g_ledState = LOW;
+
+/**
+ * @brief variable to indicate if a bothering command was received and the LED is flashing for it
+ *
+ */
+int g_botheringStarted = 0;
+
+/********************************************************************************************************************************************
+ *                           Functions
+ ********************************************************************************************************************************************/
+
+/**
+ * @brief Print a mac address out to serial
+ *
+ */
+void printMacAddress(MacKey mac)
+{
+  char macStr[18];
+  snprintf(macStr, sizeof(macStr), "%02x:%02x:%02x:%02x:%02x:%02x",
+           mac.byte(0), mac.byte(1), mac.byte(2), mac.byte(3), mac.byte(4), mac.byte(5));
+  Serial.print(macStr);
+}
+
+/**
+ * @brief print a single log entry, if there's room in the Serial transmit buffer
+ * Depends on printMacAddress
+ *
+ * @return false if the entry has to wait for the next drain
+ */
+template <uint16_t SIZE>
+boolean drainLogEntry(LogRing<SIZE> &ring)
+{
+  const log_entry *entry = ring.peek();
+  if (entry == NULL || Serial.availableForWrite() < 80) // Never wait on the UART, there'll be room next time
+  {
+    return false;
+  }
+  const log_message &message = LOG_MESSAGES[entry->event];
+  Serial.print(entry->time);
+  Serial.print(" ");
+  Serial.print(message.text);
+  if (message.flags & LOG_WITH_VALUE)
+  {
+    Serial.print(entry->value);
+    Serial.print(" ");
+  }
+  if (message.flags & LOG_WITH_MAC)
+  {
+    printMacAddress(MacKey(entry->mac));
+  }
+  Serial.println();
+  ring.pop();
+  return true;
+}
+
+/**
+ * @brief print whatever has been logged since the last call
+ * Depends on drainLogEntry
+ *
+ * Called from every pass through loop(). Stops as soon as the Serial buffer is full instead of blocking.
+ *
+ */
+void drainLog()
+{
+  while (drainLogEntry(g_log))
+  {
+  }
+  uint32_t drops = g_log.dropped();
+  if (drops != g_reportedLogDrops && Serial.availableForWrite() >= 80)
+  {
+    Serial.print("****WARNING! LOG OVERRAN, ENTRIES DROPPED: ");
+    Serial.println(drops - g_reportedLogDrops);
+    g_reportedLogDrops = drops;
+  }
+}
+
+/**
+ * @brief set one of the LEDs, tracing the change
+ *
+ */
+void writeLed(uint8_t pin, uint8_t level)
+{
+  digitalWrite(pin, level);
+  g_trace.instant(TRACE_LED, pin, level);
+}
+
+/**
+ * @brief move loop() on to a new phase, so its passes are timed and traced against it
+ *
+ */
+void setLoopPhase(loop_phase phase)
+{
+  g_loopPhase = phase;
+  g_trace.instant(TRACE_PHASE, 0, phase);
+}
+
+/**
+ * @brief print a number of cycles as microseconds, to a tenth
+ *
+ */
+void printCyclesAsMicros(uint64_t cycles)
+{
+  Serial.print((double)cycles / ESP.getCpuFreqMHz(), 1);
+  Serial.print("us");
+}
+
+/**
+ * @brief print the next rows of g_timings for the stats command, if there's room in the Serial transmit buffer
+ * Depends on printCyclesAsMicros
+ *
+ * Called from every pass through loop(). Prints a row at a time and stops as soon as the Serial buffer is full,
+ * like drainLog(), so asking for stats never holds up a turn.
+ *
+ */
+void printTimings()
+{
+  while (g_timingRow >= 0 && Serial.availableForWrite() >= 80)
+  {
+    if (g_timingRow == 0)
+    {
+      Serial.print("Timings since boot or the last stats reset, at ");
+      Serial.print(millis());
+      Serial.println("ms:");
+    }
+    else
+    {
+      const timing_stat &stat = g_timings.at(g_timingRow - 1);
+      Serial.print("  ");
+      Serial.print(TIMING_NAMES[g_timingRow - 1]);
+      Serial.print(": ");
+      Serial.print(stat.count);
+      Serial.print(" runs");
+      if (stat.count > 0)
+      {
+        Serial.print(", min ");
+        printCyclesAsMicros(stat.minCycles);
+        Serial.print(", mean ");
+        printCyclesAsMicros(stat.totalCycles / stat.count);
+        Serial.print(", max ");
+        printCyclesAsMicros(stat.maxCycles);
+      }
+      Serial.println();
+    }
+    g_timingRow = g_timingRow < TIMING_COUNT ? g_timingRow + 1 : -1;
+  }
+}
+
+/**
+ * @brief print one row of link counters, without its name
+ *
+ */
+void printLinkCounters(const link_counters &counters)
+{
+  Serial.print(": tx ");
+  Serial.print(counters.txFrames);
+  Serial.print(", ok ");
+  Serial.print(counters.txSuccess);
+  Serial.print(", fail ");
+  Serial.print(counters.txFail);
+  Serial.print(", resent ");
+  Serial.print(counters.retransmits);
+  Serial.print(", rx ");
+  Serial.print(counters.rxFrames);
+  Serial.print(", dup ");
+  Serial.print(counters.duplicates);
+  Serial.print(", rx bytes ");
+  Serial.print(counters.rxBytes);
+}
+
+/**
+ * @brief print the next rows of g_linkStats for the links command, if there's room in the Serial transmit buffer
+ * Depends on printLinkCounters and printMacAddress
+ *
+ * Row 0 is the heading, then one row per purpose, then one per peer with its moving average success rate.
+ *
+ */
+void printLinks()
+{
+  const int8_t purposes = MSG_PEER_DELTA + 1;
+  while (g_linkRow >= 0 && Serial.availableForWrite() >= 128)
+  {
+    if (g_linkRow == 0)
+    {
+      Serial.print("Link counters since boot or the last links reset, at ");
+      Serial.print(millis());
+      Serial.println("ms:");
+    }
+    else if (g_linkRow <= purposes)
+    {
+      Serial.print("  purpose ");
+      Serial.print(g_linkRow - 1);
+      printLinkCounters(g_linkStats.purpose(g_linkRow - 1));
+      Serial.println();
+    }
+    else
+    {
+      uint8_t peer = g_linkRow - 1 - purposes;
+      Serial.print("  ");
+      printMacAddress(g_linkStats.peerAt(peer));
+      printLinkCounters(g_linkStats.peerCountersAt(peer));
+      Serial.print(", success ");
+      Serial.print(g_linkStats.successRateAt(peer) * 100.0 / LINK_EWMA_ONE, 1);
+      Serial.println("%");
+    }
+    g_linkRow = g_linkRow < purposes + g_linkStats.peerCount() ? g_linkRow + 1 : -1;
+  }
+}
+
+/**
+ * @brief print the next records of g_trace for the trace command, if there's room in the Serial transmit buffer
+ *
+ * The dump starts with a trace begin line naming this device, and recording is paused until the trace end line so
+ * the records being printed aren't overwritten. tools/traceToChrome.py turns dumps into Chrome trace_event JSON.
+ *
+ */
+void printTrace()
+{
+  while (g_traceRow >= 0 && Serial.availableForWrite() >= 80)
+  {
+    if (g_traceRow == 0)
+    {
+      g_trace.pause(true);
+      Serial.print("trace begin,");
+      printMacAddress(OWN_MAC_ADDRESS);
+      Serial.print(",");
+      Serial.print(g_trace.count());
+      Serial.print(",");
+      Serial.println(g_trace.overwritten());
+    }
+    else if (g_traceRow <= g_trace.count())
+    {
+      const trace_record &record = g_trace.at(g_traceRow - 1);
+      Serial.print("trace,");
+      Serial.print(record.time);
+      Serial.print(record.kind == TRACE_BEGIN ? ",B," : record.kind == TRACE_END ? ",E," : ",i,");
+      Serial.print(TRACE_NAMES[record.event]);
+      Serial.print(",");
+      Serial.print(record.arg);
+      Serial.print(",");
+      Serial.println(record.value);
+    }
+    else
+    {
+      Serial.println("trace end");
+      g_trace.pause(false);
+      g_traceRow = -1;
+      break;
+    }
+    g_traceRow++;
+  }
+}
+
+/**
+ * @brief stats: print the timers, a few rows per pass through loop()
+ *
+ */
+void statsCommand()
+{
+  g_timingRow = 0;
+}
+
+/**
+ * @brief stats reset: start the timers over
+ *
+ */
+void statsResetCommand()
+{
+  g_timings.reset();
+  Serial.println("Stats reset");
+}
+
+/**
+ * @brief a line that can be typed into the serial monitor and the function that runs it
+ *
+ */
+typedef struct serial_command
+{
+  const char *name;
+  void (*run)();
+} serial_command;
+
+/**
+ * @brief links: print the counters for every purpose and every peer, a few rows per pass through loop()
+ *
+ */
+void linksCommand()
+{
+  g_linkRow = 0;
+}
+
+/**
+ * @brief links reset: zero the link counters and forget every peer they were kept for
+ *
+ */
+void linksResetCommand()
+{
+  g_linkStats.reset();
+  Serial.println("Links reset");
+}
+
+/**
+ * @brief trace: print every trace record, oldest first, a few per pass through loop()
+ *
+ */
+void traceCommand()
+{
+  g_traceRow = 0;
+}
+
+/**
+ * @brief trace clear: throw away every trace record so the next dump only has what happens from now on
+ *
+ */
+void traceClearCommand()
+{
+  g_trace.clear();
+  Serial.println("Trace cleared");
+}
+
+static const serial_command SERIAL_COMMANDS[] = {
+    {"stats", statsCommand},
+    {"stats reset", statsResetCommand},
+    {"links", linksCommand},
+    {"links reset", linksResetCommand},
+    {"trace", traceCommand},
+    {"trace clear", traceClearCommand},
+};
+
+/**
+ * @brief run a line typed into the serial monitor
+ *
+ */
+void runSerialCommand(const char *line)
+{
+  for (const serial_command &command : SERIAL_COMMANDS)
+  {
+    if (strcmp(line, command.name) == 0)
+    {
+      command.run();
+      return;
+    }
+  }
+  Serial.print("Unknown command: ");
+  Serial.print(line);
+  Serial.print(", try");
+  for (const serial_command &command : SERIAL_COMMANDS)
+  {
+    Serial.print(command.name == SERIAL_COMMANDS[0].name ? ": " : ", ");
+    Serial.print(command.name);
+  }
+  Serial.println();
+}
+
+/**
+ * @brief collect whatever has been typed into the serial monitor, running each line as it's finished
+ * Depends on runSerialCommand
+ *
+ * Only reads what's already in the receive buffer, so it never waits for the rest of a line.
+ *
+ */
+void readSerialCommands()
+{
+  while (Serial.available() > 0)
+  {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r')
+    {
+      if (g_serialCommandLength < sizeof(g_serialCommand) - 1) // Anything past the longest command is dropped
+      {
+        g_serialCommand[g_serialCommandLength++] = c;
+      }
+      continue;
+    }
+    if (g_serialCommandLength > 0)
+    {
+      g_serialCommand[g_serialCommandLength] = '\0';
+      g_serialCommandLength = 0;
+      runSerialCommand(g_serialCommand);
+    }
+  }
+}
+
+/**
+ * @brief build a packet holding the type byte and one mac address (purpose 4)
+ *
+ */
+autosync_packet makeAddressPacket(uint8_t type, MacKey address)
+{
+  autosync_packet packet = {};
+  packet.length = sizeof(address_msg);
+  packet.header.type = type;
+  packet.addressMsg.address = address;
+  return packet;
+}
+
+/**
+ * @brief print a list of peers
+ *  Depends on printMacAddress
+ *
+ */
+void printPeers(const PeerTable<MAX_PEERS> &peersToPrint)
+{
+  Serial.println("Printing Peers:");
+  for (int i = 0; i < peersToPrint.count(); i++)
+  {
+    Serial.print(i + 1);
+    Serial.print(": ");
+    printMacAddress(peersToPrint.at(i));
+    Serial.println();
+  }
+}
+
+/**
+ * @brief log a list of peers
+ *
+ *  Same as printPeers, but through g_log, so it comes out in order with the events around it and never waits on Serial
+ *
+ */
+void logPeers(const PeerTable<MAX_PEERS> &peersToLog)
+{
+  for (int i = 0; i < peersToLog.count(); i++)
+  {
+    g_log.push(LOG_PEER, i + 1, peersToLog.at(i));
+  }
+}
+
+// Interrupts for each button, which only record the edge for g_buttons to debounce in loop()
+IRAM_ATTR void syncButtonInterrupt()
+{
+  g_buttons.onEdge(BUTTON_SYNC);
+}
+
+IRAM_ATTR void prevButtonInterrupt()
+{
+  g_buttons.onEdge(BUTTON_PREV);
+}
+
+IRAM_ATTR void nextButtonInterrupt()
+{
+  g_buttons.onEdge(BUTTON_NEXT);
+}
+
+IRAM_ATTR void flashButtonInterrupt()
+{
+  g_buttons.onEdge(BUTTON_FLASH);
+}
+
+/**
+ * @brief hand every debounced button event to the current phase's handler
+ *
+ */
+void dispatchButtonEvents()
+{
+  button_event event;
+  while (g_buttons.nextEvent(event))
+  {
+    g_trace.instant(TRACE_BUTTON, event.button, event.type);
+    if (event.type == BUTTON_PRESSED)
+    {
+      g_log.push(LOG_BUTTON_PRESSED, event.button);
+    }
+    else
+    {
+      g_log.push(event.type == BUTTON_HELD ? LOG_BUTTON_HELD : LOG_BUTTON_RELEASED, event.duration);
+    }
+    if (g_buttonHandler != NULL)
+    {
+      g_buttonHandler(event);
+    }
+  }
+}
+
+/********************************************************************************************************************************************
+ *                           Transmit Queue
+ ********************************************************************************************************************************************/
+// Every frame goes through g_txQueue so that each OnDataSent() result can be matched to the frame it belongs to.
+// A reliable message stays in its slot until every registered peer has reported success. Peers that failed get the
+// frame again, unicast to just them, with jittered exponential backoff. Only one esp_now_send() is outstanding at a
+// time: the next frame goes out once every peer has reported on the last one, so the SDK's send buffer never fills
+// up, and a message that replaces an older one of the same purpose takes over its slot instead of queueing behind it.
+// The next frame is always the highest priority class that has anything ready, so a turn pass never waits behind
+// peer lists, retransmits or pokes for more than the one send that's already outstanding.
+
+/**
+ * @brief the esp now peers that frames are currently sent to: just the broadcast address while syncing, then every
+ * synced peer
+ *
+ * A peer's index in this list is its bit in the tx_slot masks.
+ *
+ */
+PeerTable<MAX_PEERS> g_linkPeers;
+
+static_assert(MAX_PEERS <= 32, "Every link peer needs a bit in a uint32_t mask");
+
+/**
+ * @brief the state of one slot in the transmit queue
+ *
+ * TX_FREE: nothing in it
+ * TX_READY: waiting its turn to send to the peers in unsent
+ * TX_IN_FLIGHT: it's in the outstanding esp_now_send(), waiting for OnDataSent() from every peer in g_txAwaiting
+ * TX_WAITING_RETRY: at least one peer failed, retransmit to the peers still pending when dueAt is reached
+ *
+ */
+enum tx_state : uint8_t
+{
+  TX_FREE,
+  TX_READY,
+  TX_IN_FLIGHT,
+  TX_WAITING_RETRY
+};
+
+/**
+ * @brief the priority classes of the transmit queue, highest first
+ *
+ * TX_CLASS_TURN: who the current player is and the turn order, the messages a player is waiting on
+ * TX_CLASS_MEMBERSHIP: sync beacons, small and what sync is timed by
+ * TX_CLASS_DIAGNOSTICS: pokes, which repeat anyway
+ * TX_CLASS_BULK: peer digests, lists and deltas. The digest has to stay in line behind any list or delta queued before
+ * it, or a peer would compare it against a list that hasn't arrived yet and ask for the whole list again.
+ *
+ */
+enum tx_class : uint8_t
+{
+  TX_CLASS_TURN,
+  TX_CLASS_MEMBERSHIP,
+  TX_CLASS_DIAGNOSTICS,
+  TX_CLASS_BULK
+};
+
+/**
+ * @brief a message in the transmit queue
+ *
+ * uint32_t pending:
+ * The link peers that haven't acknowledged the message yet, it's done when this is empty
+ *
+ * uint32_t unsent:
+ * The link peers the current attempt hasn't been sent to yet
+ *
+ * uint32_t dueAt:
+ * While ready, when it became ready. While waiting, when to retransmit.
+ *
+ * uint16_t order:
+ * Increases with every attempt that becomes ready, so the oldest ready attempt is sent first
+ *
+ */
+typedef struct tx_slot
+{
+  autosync_packet packet;
+  tx_state state;
+  boolean reliable;
+  uint8_t attempts;
+  uint16_t order;
+  uint32_t pending;
+  uint32_t unsent;
+  uint32_t dueAt;
+} tx_slot;
+
+/**
+ * @brief one OnDataSent() result, waiting in g_txResults to be matched to its frame in loop()
+ *
+ * uint32_t time:
+ * micros() when it was reported, for the trace
+ *
+ */
+typedef struct tx_result
+{
+  uint32_t time;
+  uint8_t mac[6];
+  uint8_t status;
+} tx_result;
+
+/**
+ * @brief the number of messages that can be queued or in flight at once
+ *
+ */
+static const uint8_t TX_QUEUE_SIZE = 8;
+
+/**
+ * @brief the number of OnDataSent() results that can wait for loop(), enough for a send to every peer
+ *
+ */
+static const uint16_t TX_RESULTS_SIZE = 32;
+static_assert(TX_RESULTS_SIZE >= MAX_PEERS, "A send to every peer has to fit all its results");
+
+/**
+ * @brief the number of times a reliable message is sent before giving up on it
+ *
+ */
+static const uint8_t TX_MAX_ATTEMPTS = 6;
+
+/**
+ * @brief the retransmit backoff starts at this and doubles with every attempt up to TX_BACKOFF_MAX_MS
+ *
+ */
+TUNABLE uint32_t TX_BACKOFF_BASE_MS = 20;
+static const uint32_t TX_BACKOFF_MAX_MS = 640;
+
+/**
+ * @brief how long to wait for OnDataSent() before counting a peer that hasn't reported as failed
+ *
+ */
+TUNABLE uint32_t TX_RESULT_TIMEOUT_MS = 200;
+
+/**
+ * @brief how long a new message waits for others to share its frame, like the reply that follows a turn order
+ *
+ */
+TUNABLE uint32_t TX_BATCH_WINDOW_MS = 2;
+
+tx_slot g_txQueue[TX_QUEUE_SIZE] = {};
+
+/**
+ * @brief results written by OnDataSent() and read by serviceTxQueue(), so the callback never touches g_txQueue
+ *
+ */
+SpscRing<tx_result, TX_RESULTS_SIZE> g_txResults;
+
+/**
+ * @brief the slots whose messages are in the outstanding esp_now_send(), one bit each, 0 when the next frame can go out
+ *
+ */
+uint8_t g_txInFlight = 0;
+
+static_assert(TX_QUEUE_SIZE <= 8, "Every transmit slot needs a bit in g_txInFlight");
+
+/**
+ * @brief the frame being sent when it's a batch of several messages
+ *
+ */
+batch_msg g_txBatch;
+
+/**
+ * @brief the link peers that haven't reported on the outstanding esp_now_send() yet
+ *
+ */
+uint32_t g_txAwaiting = 0;
+
+/**
+ * @brief millis() when the outstanding esp_now_send() was made
+ *
+ */
+uint32_t g_txSentAt = 0;
+
+/**
+ * @brief how many frames have gone to each link peer, and how many of them OnDataSent() has reported on, both wrapping
+ *
+ * OnDataSent() only says which peer a result is for, but esp now reports on a peer's frames in the order they were
+ * sent. So a peer's next result is for frame g_txReported + 1, and it's for the outstanding send only if that's the
+ * frame number the send got in g_txSentTo. Any other result is a late one for a send that had already timed out.
+ *
+ */
+uint8_t g_txSentTo[MAX_PEERS];
+uint8_t g_txReported[MAX_PEERS];
+
+/**
+ * @brief until this millis(), the radio is left to finish the frames whose results timed out before the next one goes
+ *
+ */
+uint32_t g_txLateUntil = 0;
+
+/**
+ * @brief the sequence number of the next message this device sends
+ *
+ */
+uint8_t g_nextSeq = 0;
+
+/**
+ * @brief the order of the next attempt that becomes ready
+ *
+ */
+uint16_t g_nextTxOrder = 0;
+
+/**
+ * @brief the number of deliveries that have failed, including sends esp now refused, for spotting a congested channel
+ *
+ */
+uint32_t g_deliveryFailures = 0;
+
+/**
+ * @brief register an esp now peer and give it a bit in the transmit masks
+ *
+ */
+void addLinkPeer(MacKey mac)
+{
+  if (g_linkPeers.insert(mac) == PEER_ADDED)
+  {
+    uint8_t bytes[6];
+    mac.toBytes(bytes);
+    esp_now_add_peer(bytes, ESP_NOW_ROLE_COMBO, WIFI_CHANNEL, NULL, 0);
+  }
+}
+
+/**
+ * @brief unregister every esp now peer
+ *
+ * Anything still queued is dropped, since its peer masks no longer match g_linkPeers. Results for a frame that was
+ * still outstanding no longer match anything, and are only counted.
+ *
+ */
+void clearLinkPeers()
+{
+  for (int i = 0; i < g_linkPeers.count(); i++)
+  {
+    uint8_t bytes[6];
+    g_linkPeers.at(i).toBytes(bytes);
+    esp_now_del_peer(bytes);
+  }
+  g_linkPeers.clear();
+  for (int i = 0; i < TX_QUEUE_SIZE; i++)
+  {
+    g_txQueue[i].state = TX_FREE;
+  }
+  g_txInFlight = 0;
+  g_txAwaiting = 0;
+  memset(g_txSentTo, 0, sizeof(g_txSentTo));
+  memset(g_txReported, 0, sizeof(g_txReported));
+}
+
+/**
+ * @brief a mask with a bit set for every link peer
+ *
+ */
+uint32_t allLinkPeersMask()
+{
+  return g_linkPeers.count() >= 32 ? 0xFFFFFFFF : ((uint32_t)1 << g_linkPeers.count()) - 1;
+}
+
+/**
+ * @brief how long to wait before the next attempt: exponential in the number of attempts, with random jitter
+ *
+ * Uses "equal jitter": half the backoff is fixed and half is random, so two docks that failed together don't retry
+ * together.
+ *
+ */
+uint32_t txBackoffMs(uint8_t attempts)
+{
+  uint32_t backoff = TX_BACKOFF_BASE_MS << (attempts > 1 ? attempts - 1 : 0);
+  if (backoff > TX_BACKOFF_MAX_MS)
+  {
+    backoff = TX_BACKOFF_MAX_MS;
+  }
+  return backoff / 2 + random(backoff / 2 + 1);
+}
+
+/**
+ * @brief the priority class a message is sent in
+ *
+ */
+tx_class txClassOf(uint8_t type)
+{
+  switch (type & MSG_TYPE_MASK)
+  {
+  case MSG_SET_PLAYER:
+  case MSG_TURN_ORDER:
+    return TX_CLASS_TURN;
+  case MSG_SYNCING:
+    return TX_CLASS_MEMBERSHIP;
+  case MSG_POKE:
+    return TX_CLASS_DIAGNOSTICS;
+  default:
+    return TX_CLASS_BULK;
+  }
+}
+
+/**
+ * @brief whether a ready slot goes out before another: the higher priority class first, then the oldest attempt
+ *
+ */
+boolean txGoesBefore(const tx_slot &slot, const tx_slot &other)
+{
+  tx_class slotClass = txClassOf(slot.packet.header.type);
+  tx_class otherClass = txClassOf(other.packet.header.type);
+  return slotClass != otherClass ? slotClass < otherClass : (int16_t)(slot.order - other.order) < 0;
+}
+
+/**
+ * @brief make a slot's next attempt ready to send to every peer still pending
+ *
+ */
+void readyTxAttempt(tx_slot &slot)
+{
+  if (slot.attempts > 0)
+  {
+    slot.packet.header.type |= MSG_RESEND_FLAG;
+    g_log.push(LOG_TX_RETRY, slot.packet.header.seq);
+  }
+  slot.attempts++;
+  slot.state = TX_READY;
+  slot.order = g_nextTxOrder++;
+  slot.unsent = slot.pending;
+  slot.dueAt = millis();
+}
+
+/**
+ * @brief every peer has been sent the current attempt and reported on it: free the slot, or schedule a retransmit if
+ * anyone is still pending
+ *
+ */
+void finishTxAttempt(tx_slot &slot)
+{
+  if (slot.pending == 0 || !slot.reliable)
+  {
+    slot.state = TX_FREE;
+  }
+  else if (slot.attempts >= TX_MAX_ATTEMPTS)
+  {
+    g_log.push(LOG_TX_GAVE_UP, slot.packet.header.seq);
+    slot.state = TX_FREE;
+  }
+  else
+  {
+    slot.state = TX_WAITING_RETRY;
+    slot.dueAt = millis() + txBackoffMs(slot.attempts);
+  }
+}
+
+/**
+ * @brief the outstanding esp_now_send() has been reported on, or never will be: free the radio for the next frame
+ *
+ */
+void finishTxSend()
+{
+  for (int i = 0; i < TX_QUEUE_SIZE; i++)
+  {
+    tx_slot &slot = g_txQueue[i];
+    if ((g_txInFlight & (1 << i)) == 0)
+    {
+      continue;
+    }
+    if (slot.unsent != 0) // The rest of the attempt keeps its place at the front
+    {
+      slot.state = TX_READY;
+    }
+    else
+    {
+      finishTxAttempt(slot);
+    }
+  }
+  g_txInFlight = 0;
+  g_txAwaiting = 0;
+}
+
+/**
+ * @brief count a message in a frame esp now accepted for some link peers, under its purpose
+ *
+ */
+void countTxMessage(const tx_slot &slot, uint32_t to)
+{
+  link_counters &purpose = g_linkStats.purpose(slot.packet.header.type & MSG_TYPE_MASK);
+  uint8_t peers = __builtin_popcount(to);
+  purpose.txFrames += peers;
+  purpose.retransmits += slot.attempts > 1 ? peers : 0;
+}
+
+/**
+ * @brief count a frame esp now accepted under each link peer it went to
+ *
+ */
+void countTxFrame(uint32_t to, boolean resend)
+{
+  for (int i = 0; i < g_linkPeers.count(); i++)
+  {
+    link_counters *peer = (to & ((uint32_t)1 << i)) ? g_linkStats.peer(g_linkPeers.at(i)) : NULL;
+    if (peer != NULL)
+    {
+      peer->txFrames++;
+      peer->retransmits += resend;
+    }
+  }
+}
+
+/**
+ * @brief the slot to batch next: the first ready one by txGoesBefore() that still has to go to every peer in to and
+ * fits in the frame
+ *
+ * @param batched the slots already in the frame, one bit each
+ * @param room the bytes left in the frame
+ * @return NULL if there isn't one
+ */
+tx_slot *nextTxBatchSlot(uint32_t to, uint8_t batched, uint8_t room)
+{
+  tx_slot *next = NULL;
+  for (int i = 0; i < TX_QUEUE_SIZE; i++)
+  {
+    tx_slot &slot = g_txQueue[i];
+    if (slot.state == TX_READY && (batched & (1 << i)) == 0 && (slot.unsent & to) == to &&
+        slot.packet.length < room && (next == NULL || txGoesBefore(slot, *next)))
+    {
+      next = &slot;
+    }
+  }
+  return next;
+}
+
+/**
+ * @brief make the one esp_now_send() for the next part of a slot's current attempt, with any other ready messages
+ * for the same peers batched into the same frame
+ * Depends on nextTxBatchSlot, finishTxSend, countTxMessage and countTxFrame
+ *
+ * An attempt to every link peer is a single esp_now_send() to all of them. Otherwise it's unicast to each peer it
+ * still has to go to, one per call, so one flaky seat doesn't make the whole table hear the frame again. Messages are
+ * batched in the order they'd have been sent in, so they're handled in that order too.
+ *
+ */
+void transmitTxSlot(tx_slot &first)
+{
+  uint32_t to = first.unsent == allLinkPeersMask() ? first.unsent : first.unsent & -first.unsent;
+  uint8_t batched = 1 << (&first - g_txQueue);
+  uint8_t length = sizeof(msg_header);
+  boolean resend = false;
+  tx_slot *slot = &first;
+  while (slot != NULL)
+  {
+    g_txBatch.records[length - sizeof(msg_header)] = slot->packet.length;
+    memcpy(&g_txBatch.records[length + 1 - sizeof(msg_header)], slot->packet.bytes, slot->packet.length);
+    length += 1 + slot->packet.length;
+    resend |= slot->attempts > 1;
+    slot = nextTxBatchSlot(to, batched, ESPNOW_MAX_FRAME - length);
+    if (slot != NULL)
+    {
+      batched |= 1 << (slot - g_txQueue);
+    }
+  }
+  boolean single = (batched & (batched - 1)) == 0;
+  const uint8_t *frame = single ? first.packet.bytes : (const uint8_t *)&g_txBatch;
+  if (single)
+  {
+    length = first.packet.length;
+  }
+  else
+  {
+    g_txBatch.header.type = MSG_BATCH;
+    g_txBatch.header.seq = first.packet.header.seq;
+  }
+
+  auto span = g_trace.span(TRACE_TRANSMIT, frame[0], frame[1]);
+  int result;
+  if (to == allLinkPeersMask())
+  {
+    result = esp_now_send(0, (uint8_t *)frame, length);
+  }
+  else
+  {
+    uint8_t bytes[6];
+    g_linkPeers.at(__builtin_ctz(to)).toBytes(bytes);
+    result = esp_now_send(bytes, (uint8_t *)frame, length);
+  }
+  for (int i = 0; i < TX_QUEUE_SIZE; i++)
+  {
+    if (batched & (1 << i))
+    {
+      g_txQueue[i].unsent &= ~to;
+      g_txQueue[i].state = TX_IN_FLIGHT;
+      if (result == 0)
+      {
+        countTxMessage(g_txQueue[i], to);
+      }
+    }
+  }
+  g_txInFlight = batched;
+  if (result != 0) // Nothing went out, so no results will come back and these peers stay pending
+  {
+    g_log.push(LOG_SEND_ERROR, result, to == allLinkPeersMask() ? DUMMY_ADDRESS : g_linkPeers.at(__builtin_ctz(to)));
+    g_deliveryFailures++;
+    finishTxSend();
+    return;
+  }
+  countTxFrame(to, resend);
+  for (uint32_t peers = to; peers != 0; peers &= peers - 1)
+  {
+    g_txSentTo[__builtin_ctz(peers)]++;
+  }
+  g_txAwaiting = to;
+  g_txSentAt = millis();
+}
+
+/**
+ * @brief whether a newer message of a purpose replaces any older one still queued
+ *
+ * These carry the sender's whole state rather than a change to it, so a peer that still needs the older one only
+ * needs the newer one. Delivering the older one after the newer one would even put it back, like a turn passed twice.
+ *
+ */
+boolean txSupersedes(uint8_t type)
+{
+  switch (type & MSG_TYPE_MASK)
+  {
+  case MSG_SYNCING:
+  case MSG_PEER_LIST:
+  case MSG_SET_PLAYER:
+  case MSG_POKE:
+  case MSG_PEER_DIGEST:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief whether two messages say the same thing, whatever their sequence numbers and resend flags
+ *
+ */
+boolean samePayload(const autosync_packet &a, const autosync_packet &b)
+{
+  return a.length == b.length && (a.header.type & MSG_TYPE_MASK) == (b.header.type & MSG_TYPE_MASK) &&
+         memcmp(a.bytes + sizeof(msg_header), b.bytes + sizeof(msg_header), a.length - sizeof(msg_header)) == 0;
+}
+
+/**
+ * @brief queue a message to some of the link peers, to be sent when the radio is free
+ * Depends on readyTxAttempt, txSupersedes and samePayload
+ *
+ * Only the first toSend.length bytes of the message go on the wire. The message is given the next sequence number.
+ * If it supersedes an older message that's still queued, it's merged: when they say the same thing, the older one is
+ * just sent to these peers too if it hasn't gone out yet. Otherwise the new one takes over the older one's slot and
+ * its place in line, and goes to every peer that was still owed the older one as well. TX_CLASS_BULK messages go to
+ * the back of the line instead, so a digest never overtakes a list or delta that was queued after the digest it
+ * replaces.
+ *
+ * @param toSend the message, which is copied into the queue
+ * @param reliable true to retransmit until every peer has it, false to send it once
+ * @param peerMask the link peers to send it to, one bit each
+ * @return false if the queue was full and the message was dropped
+ */
+boolean sendPacketTo(const autosync_packet &toSend, boolean reliable, uint32_t peerMask)
+{
+  if (peerMask == 0)
+  {
+    return true; // Nobody to send it to
+  }
+  for (int i = 0; txSupersedes(toSend.header.type) && i < TX_QUEUE_SIZE; i++)
+  {
+    tx_slot &same = g_txQueue[i];
+    if (same.state == TX_READY && same.attempts == 1 && same.unsent == same.pending && same.reliable == reliable &&
+        samePayload(same.packet, toSend)) // Not sent to anyone yet, so nobody would drop it as a duplicate
+    {
+      same.pending |= peerMask;
+      same.unsent |= peerMask;
+      return true;
+    }
+  }
+  tx_slot *slot = NULL;
+  for (int i = 0; txSupersedes(toSend.header.type) && i < TX_QUEUE_SIZE; i++)
+  {
+    tx_slot &older = g_txQueue[i];
+    if (older.state == TX_FREE || (older.packet.header.type & MSG_TYPE_MASK) != (toSend.header.type & MSG_TYPE_MASK))
+    {
+      continue;
+    }
+    g_log.push(LOG_TX_SUPERSEDED, older.packet.header.seq);
+    peerMask |= older.pending;
+    if (older.state == TX_IN_FLIGHT) // It can't be called back, but it won't be sent again
+    {
+      older.pending = 0;
+      older.unsent = 0;
+    }
+    else if (slot == NULL)
+    {
+      slot = &older;
+    }
+    else
+    {
+      older.state = TX_FREE;
+    }
+  }
+  for (int i = 0; slot == NULL && i < TX_QUEUE_SIZE; i++)
+  {
+    if (g_txQueue[i].state == TX_FREE)
+    {
+      slot = &g_txQueue[i];
+    }
+  }
+  if (slot == NULL)
+  {
+    g_log.push(LOG_TX_QUEUE_FULL, toSend.header.type);
+    return false;
+  }
+  boolean inLine = slot->state == TX_READY && txClassOf(toSend.header.type) != TX_CLASS_BULK;
+  uint16_t order = slot->order;
+  slot->packet = toSend;
+  slot->packet.header.seq = g_nextSeq++;
+  slot->reliable = reliable;
+  slot->attempts = 0;
+  slot->pending = peerMask;
+  readyTxAttempt(*slot);
+  if (inLine)
+  {
+    slot->order = order;
+  }
+  return true;
+}
+
+/**
+ * @brief queue a message to all peers
+ *
+ */
+boolean sendPacket(const autosync_packet &toSend, boolean reliable)
+{
+  return sendPacketTo(toSend, reliable, allLinkPeersMask());
+}
+
+/**
+ * @brief match a result from OnDataSent() to the outstanding send by the frame number it's for
+ *
+ */
+void recordTxResult(MacKey mac, boolean success)
+{
+  if (!success)
+  {
+    g_deliveryFailures++;
+  }
+  int peer = g_linkPeers.indexOf(mac);
+  uint32_t bit = peer >= 0 ? (uint32_t)1 << peer : 0;
+  boolean current = peer >= 0 && ++g_txReported[peer] == g_txSentTo[peer];
+  if (g_txInFlight == 0 || (g_txAwaiting & bit) == 0 || !current) // Too late, its send already timed out
+  {
+    g_linkStats.recordResult(0, mac, success);
+    return;
+  }
+  boolean counted = false; // The peer's counters and success rate only count the frame once
+  for (int i = 0; i < TX_QUEUE_SIZE; i++)
+  {
+    tx_slot &slot = g_txQueue[i];
+    if ((g_txInFlight & (1 << i)) == 0)
+    {
+      continue;
+    }
+    if (!counted)
+    {
+      g_linkStats.recordResult(slot.packet.header.type & MSG_TYPE_MASK, mac, success);
+      counted = true;
+    }
+    else
+    {
+      link_counters &purpose = g_linkStats.purpose(slot.packet.header.type & MSG_TYPE_MASK);
+      (success ? purpose.txSuccess : purpose.txFail)++;
+    }
+    if (success)
+    {
+      slot.pending &= ~bit; // This peer has it, it won't be sent to again
+    }
+  }
+  g_txAwaiting &= ~bit;
+  if (g_txAwaiting == 0)
+  {
+    finishTxSend();
+  }
+}
+
+/**
+ * @brief whether the radio still owes results for frames whose send timed out, which means it's still sending them
+ *
+ * Past g_txLateUntil they're written off as lost, so one missing result can't hold the queue up for good.
+ *
+ */
+boolean txResultsOwed(uint32_t now)
+{
+  boolean owed = false;
+  for (int i = 0; i < g_linkPeers.count(); i++)
+  {
+    owed |= g_txReported[i] != g_txSentTo[i];
+  }
+  if (owed && (int32_t)(now - g_txLateUntil) >= 0)
+  {
+    memcpy(g_txReported, g_txSentTo, sizeof(g_txReported));
+    return false;
+  }
+  return owed;
+}
+
+/**
+ * @brief match the results OnDataSent() has queued, then send the next frame if the radio is free
+ * Depends on recordTxResult, txResultsOwed, readyTxAttempt, txGoesBefore and transmitTxSlot
+ *
+ * Called from every pass through loop(), so the next frame goes out within a pass of the last one being reported on,
+ * or of TX_BATCH_WINDOW_MS after its oldest message was queued.
+ * Peers that never report on a send within TX_RESULT_TIMEOUT_MS stay pending, so the queue can't stall. The radio is
+ * still working on that frame, so the next one waits up to as long again for the missing results, then goes anyway.
+ *
+ */
+void serviceTxQueue()
+{
+  const tx_result *result;
+  while ((result = g_txResults.peek()) != NULL)
+  {
+    MacKey mac = MacKey::fromBytes(result->mac);
+    g_trace.instantAt(result->time, TRACE_TX_RESULT, result->status, (uint32_t)mac.value);
+    g_log.push(result->status == 0 ? LOG_DELIVERY_SUCCESS : LOG_DELIVERY_FAIL, 0, mac);
+    recordTxResult(mac, result->status == 0);
+    g_txResults.pop();
+  }
+  uint32_t now = millis();
+  if (g_txInFlight != 0 && now - g_txSentAt > TX_RESULT_TIMEOUT_MS)
+  {
+    g_txLateUntil = now + TX_RESULT_TIMEOUT_MS; // Give the missing results as long again to turn up before they're written off
+    finishTxSend();
+  }
+  tx_slot *next = NULL;
+  for (int i = 0; i < TX_QUEUE_SIZE; i++)
+  {
+    tx_slot &slot = g_txQueue[i];
+    if (slot.state == TX_WAITING_RETRY && (int32_t)(now - slot.dueAt) >= 0)
+    {
+      readyTxAttempt(slot);
+    }
+    if (slot.state == TX_READY && (next == NULL || txGoesBefore(slot, *next)))
+    {
+      next = &slot;
+    }
+  }
+  if (g_txInFlight == 0 && next != NULL && !txResultsOwed(now) &&
+      (next->attempts > 1 || txClassOf(next->packet.header.type) == TX_CLASS_TURN || now - next->dueAt >= TX_BATCH_WINDOW_MS))
+  {
+    transmitTxSlot(*next); // Anything queued since next has had the window to join its frame, unless a player's waiting on it
+  }
+}
+
+/**
+ * @brief register a peer that was added to g_peers after the switch from broadcast to link peers
+ *
+ * switchFromBroadcastToPeers() only links the peers in g_peers when the sync button is released. A dock heard after
+ * that, from a beacon or someone's list, would otherwise be counted and given a turn, yet never be sent to, and its
+ * digest would be ignored.
+ *
+ */
+void linkLatePeer(MacKey peer)
+{
+  if (peer != OWN_MAC_ADDRESS && g_linkPeers.indexOf(BROADCAST_ADDRESS) < 0)
+  {
+    addLinkPeer(peer);
+  }
+}
+
+/**
+ * @brief check an incoming address against the global list of peers to see if it's new, and if so, add it to the list.
+ *  Depends on linkLatePeer
+ *
+ *  @param incomingAddress the mac address to check
+ *
+ *
+ */
+void checkAndSyncAddress(MacKey incomingAddress)
+{
+  if (incomingAddress == DUMMY_ADDRESS)
+  {
+    g_log.push(LOG_DUMMY_ADDRESS);
+  }
+  else if (g_peers.insertSorted(incomingAddress) == PEER_ADDED)
+  {
+    g_log.push(LOG_NEW_PEER, 0, incomingAddress);
+    linkLatePeer(incomingAddress); // A dock still holding sync after we let go
+  }
+}
+
+/**
+ * @brief queue a peer to be passed on in the next sync beacon
+ *
+ */
+void queueGossip(MacKey peer)
+{
+  for (int i = 0; i < g_gossipCount; i++)
+  {
+    if (g_gossip[i] == peer)
+    {
+      return;
+    }
+  }
+  if (g_gossipCount < BEACON_GOSSIP_MAX) // If it's full, the next beacon that doesn't list this peer queues it again
+  {
+    g_gossip[g_gossipCount++] = peer;
+    g_log.push(LOG_GOSSIP_QUEUED, 0, peer);
+  }
+}
+
+/**
+ * @brief whether g_peers can still take new peers, which is only until catch up ends
+ *
+ * After that the turn order refers to peers by their index in g_peers, and once it's chosen g_peers is in turn order
+ * instead of sorted, so insertSorted() would move peers out from under it or put new ones in the wrong place.
+ *
+ */
+boolean peersOpen()
+{
+  return g_loopPhase <= PHASE_CATCH_UP;
+}
+
+/**
+ * @brief handle a sync beacon: add the sender and anyone it passed on, and queue anyone it hasn't heard of
+ *  Depends on peersOpen and checkAndSyncAddress
+ *
+ */
+void onSyncBeacon(const sync_beacon_msg &beacon)
+{
+  MacKey sender = beacon.address;
+  if (!peersOpen())
+  {
+    g_log.push(LOG_PEERS_SETTLED, 0, sender);
+    return;
+  }
+  g_beaconsHeard++;
+  checkAndSyncAddress(sender);
+  for (int i = 0; i < beacon.count; i++)
+  {
+    MacKey peer = beacon.peers[i];
+    if (peer != OWN_MAC_ADDRESS) // We're added to our own list when the lists are reconciled
+    {
+      checkAndSyncAddress(peer);
+    }
+  }
+  for (int i = 0; i < g_peers.count(); i++)
+  {
+    MacKey peer = g_peers.at(i);
+    if (peer != sender && peer != OWN_MAC_ADDRESS && !beacon.known.mightContain(peer))
+    {
+      queueGossip(peer);
+    }
+  }
+}
+
+/**
+ * @brief Send this device's mac address to the broadcast peer, with a summary of the peers heard so far
+ * Depends on sendPacket
+ *
+ */
+void sendMacAddress()
+{
+  // purpose 1 = I'm syncing and this is my Mac address, including the mac address of this device
+  autosync_packet sending = {};
+  sending.header.type = MSG_SYNCING;
+  sending.syncBeaconMsg.address = OWN_MAC_ADDRESS;
+  for (int i = 0; i < g_peers.count(); i++)
+  {
+    sending.syncBeaconMsg.known.add(g_peers.at(i));
+  }
+  for (int i = 0; i < g_gossipCount; i++)
+  {
+    sending.syncBeaconMsg.peers[i] = g_gossip[i];
+  }
+  sending.syncBeaconMsg.count = g_gossipCount;
+  g_gossipCount = 0;
+  sending.length = syncBeaconMsgSize(sending.syncBeaconMsg.count);
+  sendPacket(sending, false); // Send the packet, the next beacon replaces it if it's lost
+}
+
+/**
+ * @brief Remove the BROADCAST_ADDRESS from the esp now peer list and adds all peers in the peers global
+ *
+ *
+ */
+void switchFromBroadcastToPeers()
+{
+  clearLinkPeers(); // Remove the broadcast address
+  for (int i = 0; i < g_peers.count(); i++)
+  {
+    if (g_peers.at(i) != OWN_MAC_ADDRESS) // if the current peer is not this device
+    {
+      addLinkPeer(g_peers.at(i)); // add the current peer
+    }
+  }
+}
+
+/**
+ * @brief Remove the peers in the peers global from the esp now peer list and adds the BROADCAST_ADDRESS
+ *
+ *
+ */
+void switchFromPeersToBroadcast()
+{
+  clearLinkPeers();
+  addLinkPeer(BROADCAST_ADDRESS);
+}
+
+/**
+ * @brief send some link peers the peers we have that they don't
+ *
+ * @param peerMask the link peers to send to
+ * @param theirs the peers they're known to have, or NULL to send the whole list
+ */
+void sendPeerList(uint32_t peerMask, const PeerTable<MAX_PEERS> *theirs)
+{
+  autosync_packet sending = {}; // Create a packet to send
+  sending.header.type = theirs == NULL ? MSG_PEER_LIST : MSG_PEER_DELTA; // 2: the list of peers I have, 7: the ones you're missing
+  for (int i = 0; i < g_peers.count(); i++)
+  {
+    if (theirs == NULL || !theirs->contains(g_peers.at(i)))
+    {
+      sending.peerListMsg.peers[sending.peerListMsg.count++] = g_peers.at(i); // Only the used entries go on the wire
+    }
+  }
+  if (sending.peerListMsg.count == 0)
+  {
+    return;
+  }
+  sending.length = peerListMsgSize(sending.peerListMsg.count);
+  sendPacketTo(sending, true, peerMask);
+}
+
+/**
+ * @brief send the digest of our peers to some link peers
+ *
+ */
+void sendPeerDigest(uint32_t peerMask)
+{
+  autosync_packet sending = {};
+  sending.length = sizeof(peer_digest_msg);
+  sending.header.type = MSG_PEER_DIGEST;
+  sending.peerDigestMsg.count = g_peers.count();
+  sending.peerDigestMsg.digest = g_peers.digest();
+  sendPacketTo(sending, true, peerMask);
+}
+
+/**
+ * @brief Send the digest of our peers out to all currently registered peers
+ *
+ * Docks whose peers match only exchange these 7 bytes. Full lists are only sent to the ones that don't, by
+ * onPeerDigest().
+ *
+ */
+void confirmSync()
+{
+  Serial.println("Confirming sync..."); // logging
+  g_catchingUp = true;
+  g_digestsHeard = 0;
+  g_peers.insertSorted(OWN_MAC_ADDRESS); // Everyone else counts us too, so our digest has to
+  Serial.print("Peers: ");
+  Serial.println(g_peers.count());
+  printPeers(g_peers);
+  Serial.println("");
+  sendPeerDigest(allLinkPeersMask());
+}
+
+/**
+ * @brief a link peer sent the digest of its peers: remember it, and send our list if it's different
+ *
+ */
+void onPeerDigest(MacKey sender, const peer_digest_msg &incomingDigest)
+{
+  int peer = g_linkPeers.indexOf(sender);
+  if (!g_catchingUp || peer < 0)
+  {
+    return; // Our own digest goes out when we start catching up
+  }
+  uint32_t bit = (uint32_t)1 << peer;
+  boolean matchedBefore = (g_digestsHeard & bit) != 0 && g_linkPeerDigests[peer] == g_peers.digest();
+  g_digestsHeard |= bit;
+  g_linkPeerDigests[peer] = incomingDigest.digest;
+  if (incomingDigest.digest != g_peers.digest())
+  {
+    g_log.push(LOG_DIGEST_DIFFERENT, incomingDigest.count, sender);
+    sendPeerList(bit, NULL); // They'll send back whatever we're missing
+  }
+  else
+  {
+    g_log.push(LOG_DIGEST_MATCHED, 0, sender);
+    if (!matchedBefore)
+    {
+      sendPeerDigest(bit); // They may not have heard our digest since it last changed, or started catching up after it was sent
+    }
+  }
+}
+
+/**
+ * @brief whether every link peer has sent a digest that matches our peers
+ *
+ */
+boolean allPeerDigestsMatch()
+{
+  uint32_t digest = g_peers.digest();
+  for (int i = 0; i < g_linkPeers.count(); i++)
+  {
+    if ((g_digestsHeard & ((uint32_t)1 << i)) == 0 || g_linkPeerDigests[i] != digest)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Given a struct with a peers parameter, push it to the global peers vector if it's new
+ * Depends on peersOpen and linkLatePeer
+ *
+ * Only a complete list is answered with the peers the sender is missing. A delta is just the entries we lacked,
+ * so answering it with everything not in it would send back peers they already have, and they'd answer that in turn.
+ * A list that arrives after catch up is ignored, see peersOpen().
+ *
+ * @param complete true if this is the sender's whole list, false if it's a delta
+ */
+void confirmPeerList(MacKey sender, const peer_list_msg &incomingPeers, boolean complete)
+{
+  if (!peersOpen())
+  {
+    g_log.push(LOG_PEERS_SETTLED, 0, sender);
+    return;
+  }
+  int peerListChanged = 0;                      // initialize an indicator for whether the peer list has changed
+  int myMacIncluded = 0;                        // initialize an indicator for whether the current device's mac address is in the peer list
+  for (int i = 0; i < incomingPeers.count; i++) // Loop through the incoming peers
+  {
+    MacKey incomingPeer = incomingPeers.peers[i];
+    if (incomingPeer == DUMMY_ADDRESS)
+    {
+      break; // Last address
+    }
+    if (incomingPeer == BROADCAST_ADDRESS)
+    {
+      g_log.push(LOG_BROADCAST_RECEIVED);
+      continue;
+    }
+    if (incomingPeer == OWN_MAC_ADDRESS)
+    {
+      myMacIncluded = 1;
+    }
+    if (g_peers.insertSorted(incomingPeer) == PEER_ADDED) // Each lookup is a binary search, so merging the list is O(n log n)
+    {
+      g_log.push(LOG_NEW_PEER, 0, incomingPeer); // logging
+      peerListChanged++;                         // A duplicate was not found on this, the peer list was changed
+      linkLatePeer(incomingPeer); // Someone we never heard a beacon from, it has to agree on the digest too
+    }
+    else
+    {
+      g_log.push(LOG_DUPLICATE_PEER, 0, incomingPeer); // logging
+    }
+  }
+  g_log.push(LOG_MY_MAC_INCLUDED, myMacIncluded);
+  if (g_peers.insertSorted(OWN_MAC_ADDRESS) == PEER_ADDED)
+  {
+    peerListChanged++;
+  }
+  if (peerListChanged == 0)
+  {
+    g_log.push(LOG_PEER_LIST_CONFIRMED);
+  }
+  else
+  {
+    g_log.push(LOG_PEERS_ADDED, peerListChanged);
+  }
+  logPeers(g_peers);
+  if (g_catchingUp)
+  {
+    int peer = g_linkPeers.indexOf(sender);
+    if (complete && peer >= 0) // Send back only the peers they're missing
+    {
+      PeerTable<MAX_PEERS> theirs;
+      for (int i = 0; i < incomingPeers.count; i++)
+      {
+        theirs.insertSorted(incomingPeers.peers[i]);
+      }
+      sendPeerList((uint32_t)1 << peer, &theirs);
+    }
+    if (peerListChanged != 0)
+    {
+      sendPeerDigest(allLinkPeersMask()); // Our digest changed, everyone has to hear the new one
+    }
+  }
+}
+
+void checkIfCurrentPlayer()
+{
+  g_trace.instant(TRACE_CURRENT_PLAYER, 0, (uint32_t)g_currentPlayer.value);
+  if (g_currentPlayer == OWN_MAC_ADDRESS)
+  {
+    writeLed(ACTIVITY_LED, HIGH);
+    g_log.push(LOG_CURRENT_PLAYER, 0, g_currentPlayer);
+  }
+  else
+  {
+    writeLed(ACTIVITY_LED, LOW);
+    g_log.push(LOG_NOT_CURRENT_PLAYER, 0, g_currentPlayer);
+  }
+}
+
+int setNextPlayer()
+{
+  int current = g_peers.indexOf(g_currentPlayer);
+  if (current < 0)
+  {
+    return -1;
+  }
+  return (current + 1) % g_peers.count();
+}
+
+int setPrevPlayer()
+{
+  int current = g_peers.indexOf(g_currentPlayer);
+  if (current < 0)
+  {
+    return -1;
+  }
+  return current > 0 ? current - 1 : g_peers.count() - 1;
+}
+
+/**
+ * @brief a mask with a bit set for every synced peer
+ *
+ */
+uint32_t syncedPeersMask()
+{
+  return g_syncedPeers >= 32 ? 0xFFFFFFFF : ((uint32_t)1 << g_syncedPeers) - 1;
+}
+
+/**
+ * @brief whether every synced peer has chosen their turn
+ *
+ */
+boolean allSelected()
+{
+  return g_turnOrderChosen == syncedPeersMask();
+}
+
+/**
+ * @brief the number of peers that have chosen their turns
+ *
+ */
+uint8_t turnOrderCount()
+{
+  return __builtin_popcount(g_turnOrderChosen);
+}
+
+/**
+ * @brief put a peer next in the turn order, unless it's already chosen
+ *
+ * Each synced peer has a bit in g_turnOrderChosen, so a duplicate is one bit test, and the peer's index is written to
+ * g_turnOrder at the popcount. The only search is finding the sender in g_peers. When only one peer is left it doesn't
+ * have to choose: it's the lowest bit that isn't set, and goes last. Anything heard before order selection starts is
+ * kept in g_earlyTurnOrder until it does.
+ *
+ */
+void registerTurnOrder(MacKey incomingAddress)
+{
+  if (g_loopPhase < PHASE_ORDER) // g_syncedPeers isn't set yet, and the sender's index may still move
+  {
+    if (g_earlyTurnOrderCount < MAX_PEERS)
+    {
+      g_earlyTurnOrder[g_earlyTurnOrderCount++] = incomingAddress;
+    }
+    g_log.push(LOG_TURN_ORDER_EARLY, g_earlyTurnOrderCount, incomingAddress);
+    return;
+  }
+  int peer = g_peers.indexOf(incomingAddress);
+  if (peer < 0 || peer >= g_syncedPeers)
+  {
+    g_log.push(LOG_TURN_ORDER_UNKNOWN, 0, incomingAddress);
+    return;
+  }
+  uint32_t bit = (uint32_t)1 << peer;
+  uint8_t chosen = turnOrderCount();
+  if (g_turnOrderChosen & bit) // if the address is already registered, ignore
+  {
+    uint8_t position = 0;
+    while (g_turnOrder[position] != peer)
+    {
+      position++;
+    }
+    g_log.push(LOG_TURN_ORDER_DUPLICATE, position, incomingAddress);
+    return;
+  }
+  g_turnOrderChosen |= bit;
+  g_turnOrder[chosen++] = peer;
+  g_log.push(LOG_TURN_ORDER_REGISTERED, chosen - 1, incomingAddress);
+  if (chosen == g_syncedPeers - 1) // There's only one peer left to choose. We know who that is, so assign it.
+  {
+    int last = __builtin_ctz(~g_turnOrderChosen);
+    g_turnOrderChosen |= (uint32_t)1 << last;
+    g_turnOrder[chosen] = last;
+  }
 }
 
-void checkIfCurrentPlayer()
+/**
+ * @brief copy the turns chosen so far into g_tempPeers, in turn order
+ *
+ */
+void collectTurnOrder()
 {
-  if (areMacAddressesEqual(g_currentPlayer, OWN_MAC_ADDRESS))
+  g_tempPeers.clear();
+  for (uint8_t i = 0; i < turnOrderCount(); i++)
   {
-    digitalWrite(ACTIVITY_LED, HIGH);
-    Serial.print("I am the current player: ");
-    printMacAddress(g_currentPlayer);
+    g_tempPeers.insert(g_peers.at(g_turnOrder[i]));
   }
-  else
+}
+
+void sendAndRegisterTurnOrder(MacKey addressToSend)
+{
+  Serial.print("Sending turn order: ");
+  printMacAddress(addressToSend);
+  sendPacket(makeAddressPacket(MSG_TURN_ORDER, addressToSend), true);
+  registerTurnOrder(addressToSend);
+}
+
+/**
+ * Send a packet setting a new currentPlayer
+ * @param player Set this to -1 for next player, -2 for previous player, or an arbitrary player index number
+ *
+ *
+ */
+void passTurn(int player = -1)
+{
+  auto timer = g_timings.time(TIMING_PASS_TURN);
+  auto span = g_trace.span(TRACE_PASS_TURN, player);
+  if (g_currentPlayer != OWN_MAC_ADDRESS) // If this device isn't the current player
+  {                                       // Then ignore this button press
+    // g_button_pressed = 0;
+    return;
+  }
+  // Initialize a packet to send
+  autosync_packet sending = {};
+  sending.length = sizeof(set_player_msg);
+  sending.header.type = MSG_SET_PLAYER;
+  sending.setPlayerMsg.indicator = -1;
+  int nextPlayer = -1;
+  switch (player)
   {
-    digitalWrite(ACTIVITY_LED, LOW);
-    Serial.println("I am not the current player: ");
-    printMacAddress(g_currentPlayer);
-    Serial.println("");
-    printMacAddress(OWN_MAC_ADDRESS);
-    Serial.println("");
-    for (int i = 0; i < 6; i++)
+  case -1:
+    nextPlayer = setNextPlayer();
+    break;
+  case -2:
+    nextPlayer = setPrevPlayer();
+    break;
+  default:
+    if (player >= 0 && player < g_peers.count()) // If the player set is within the bounds of the player count,
+    {                            // send the specified index
+      nextPlayer = player;
+    }
+    else
     {
-      Serial.println(g_currentPlayer[i] == OWN_MAC_ADDRESS[i]);
-      Serial.print(g_currentPlayer[i]);
-      Serial.print(" | ");
-      Serial.println(OWN_MAC_ADDRESS[i]);
+      Serial.print("Cannot set this player: ");
+      Serial.println(player);
     }
+    break;
   }
+  if (nextPlayer != -1) // If a player has been set
+  {
+    sending.setPlayerMsg.indicator = nextPlayer;           // Send the index number as an indicator
+    sending.setPlayerMsg.address = g_peers.at(nextPlayer); // Set the address to the next player's address
+    g_currentPlayer = g_peers.at(nextPlayer);              // Set the local current player to the next player's address
+    sendPacket(sending, true);                             // Send the packet
+    checkIfCurrentPlayer();                                // Turn off the LED if this device is no longer the current player
+  }
+  else // The parameter was greater than the number of players or less than -2
+  {
+    Serial.println("Error in setting next player");
+  }
+  // g_button_pressed = 0;
 }
 
-int setNextPlayer()
+void playerCountBlink()
 {
-  int nextPlayer = -1;
-  for (int i = 0; i < g_syncedPeers; i++)
+  unsigned long elapsed = millis() - g_startSyncTime; // Shorthand for the time elapsed since the last blink
+  int nextPlayer = 0;                                 // variable to learn the current number of players
+  if (turnOrderCount() < g_syncedPeers)               // If anyone still has to choose
+  {
+    nextPlayer = turnOrderCount() + 1; // Increase the registered count by one to find the next player
+    // Ex: if one player has registered, the count is 1. NextPlayer should be 2, because we're searching for player 2.
+    if (nextPlayer < 2) // if there's an error, set the count to 2, because that's the true minimum
+    {
+      nextPlayer = 2;
+    }
+  }
+  if (elapsed > 1999) // If it's been longer than 2 second, restart the blink
+  {
+    Serial.print("Elapsed: ");
+    Serial.println(elapsed);
+    Serial.print("nextPlayer: ");
+    Serial.println(nextPlayer);
+    Serial.print("syncedPeers: ");
+    Serial.println(g_syncedPeers);
+    collectTurnOrder();
+    printPeers(g_tempPeers);
+    Serial.println("");
+    g_startSyncTime = millis(); // set the startSyncTime to however long ago we started blinking
+  }
+  else
   {
-    if (areMacAddressesEqual(g_currentPlayer, g_peers[i]))
+    // Blink for 200ms a number of times equal to the current player count
+    // Blink for the first 200ms, then turn off for 200ms
+    if (elapsed > (unsigned long)(199 + (200 * (nextPlayer + 1)))) // if all blinks have taken place in this period
+    {
+      writeLed(ACTIVITY_LED, LOW); // ensure the led is off
+    }
+    else
     {
-      if (!areMacAddressesEqual(g_peers[i + 1], DUMMY_ADDRESS))
+      if (elapsed % 400 < 200) // if we're in the first 200ms of this 40ms period, blink
       {
-        nextPlayer = i + 1;
+        writeLed(ACTIVITY_LED, HIGH);
       }
-      else
+      else // otherwise, turn the LED off
       {
-        nextPlayer = 0;
+        writeLed(ACTIVITY_LED, LOW);
       }
-      break;
     }
   }
-  return nextPlayer;
 }
+/*
+nextplayer == 3, 1000 == 200 + (200 * (3 + 1))
+0   200   400   600   800   1000   1200   1400   1600   1800   2000
+On--off   on----off   on----off
+*/
 
-int setPrevPlayer()
+void botherFirstPlayer()
 {
-  int nextPlayer = -1;
-  for (int i = g_syncedPeers - 1; i >= 0; i--)
+  autosync_packet sending = {};
+  sending.length = sizeof(msg_header); // A poke is only the header
+  sending.header.type = MSG_POKE;
+  sendPacket(sending, false); // Pokes repeat every half second while the buttons are held, so don't retry them
+}
+
+/********************************************************************************************************************************************
+ *                           Callbacks
+ ********************************************************************************************************************************************/
+
+// Callback when data is sent
+// It only queues the result in g_txResults: serviceTxQueue() matches it to its frame from loop()
+void OnDataSent(uint8_t *mac_addr, uint8_t sendStatus)
+{
+  auto timer = g_timings.time(TIMING_ON_DATA_SENT);
+  tx_result *result = g_txResults.claim();
+  if (result == NULL) // The send it belongs to times out instead
+  {
+    return;
+  }
+  result->time = micros();
+  memcpy(result->mac, mac_addr, sizeof(result->mac));
+  result->status = sendStatus;
+  g_txResults.commit();
+}
+
+// Callback function that will be executed when data is received
+// It only copies the frame into g_rxFrames: everything else happens in handleFrame(), called from loop()
+void OnDataRecvd(uint8_t *mac_addr, uint8_t *incomingData, uint8_t len)
+{
+  auto timer = g_timings.time(TIMING_ON_DATA_RECVD);
+  rx_frame *frame = g_rxFrames.claim();
+  if (frame == NULL) // Counted in g_rxFrames.dropped(), and reported by drainReceivedFrames()
+  {
+    return;
+  }
+  frame->time = micros();
+  memcpy(frame->mac, mac_addr, sizeof(frame->mac));
+  frame->length = len;
+  memcpy(frame->data, incomingData, len < RX_FRAME_BYTES ? len : RX_FRAME_BYTES);
+  g_rxFrames.commit();
+}
+
+/**
+ * @brief whether a message's handler can safely run again, or after a newer message from the same sender
+ *
+ * Adding peers and registering a turn only add to what's known, so one of these that's too far behind to tell whether
+ * it's been seen is handled rather than lost. The others carry state that a newer message may already have replaced.
+ *
+ */
+boolean rxIdempotent(uint8_t type)
+{
+  switch (type & MSG_TYPE_MASK)
+  {
+  case MSG_SYNCING:
+  case MSG_PEER_LIST:
+  case MSG_PEER_DELTA:
+  case MSG_TURN_ORDER:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief count one received message, drop it if it's been seen before, and hand it to its purpose's handler
+ * Depends on rxIdempotent, onSyncBeacon, confirmPeerList, checkIfCurrentPlayer, registerTurnOrder and onPeerDigest
+ *
+ * @param peerCounters the sender's link counters, or NULL if it has none
+ */
+void handleMessage(MacKey mac, const uint8_t *incomingData, uint8_t len, link_counters *peerCounters)
+{
+  uint8_t type = incomingData[0];
+  link_counters &purposeCounters = g_linkStats.purpose(type & MSG_TYPE_MASK);
+  purposeCounters.rxFrames++;
+  purposeCounters.rxBytes += len;
+  g_log.push(LOG_PURPOSE_RECEIVED, type & MSG_TYPE_MASK);
+  if (type & MSG_RESEND_FLAG)
   {
-    if (areMacAddressesEqual(g_currentPlayer, g_peers[i]))
+    g_log.push(LOG_RESEND_RECEIVED);
+  }
+  uint8_t seq = ((const msg_header *)incomingData)->seq;
+  seq_verdict verdict = g_seenFrames.check(mac, seq); // Most handlers aren't idempotent, so each message only reaches them once
+  if (verdict == SEQ_DUPLICATE || (verdict == SEQ_STALE && !rxIdempotent(type)))
+  {
+    g_log.push(verdict == SEQ_DUPLICATE ? LOG_DUPLICATE_FRAME : LOG_STALE_FRAME, seq, mac);
+    purposeCounters.duplicates++;
+    if (peerCounters != NULL)
     {
-      if (i > 0)
-      {
-        nextPlayer = i - 1;
-      }
-      else
-      {
-        nextPlayer = g_syncedPeers - 1;
+      peerCounters->duplicates++;
+    }
+    return;
+  }
+
+  // Messages are packed, so each handler gets a read-only view straight into the queued frame instead of a copy
+  auto handlerTimer = g_timings.time(TIMING_HANDLE_SYNCING + (type & MSG_TYPE_MASK) - MSG_SYNCING);
+  auto handlerSpan = g_trace.span(TRACE_DISPATCH, type, (uint32_t)(mac.value << 8) | seq);
+  switch (type & MSG_TYPE_MASK)
+  {
+  case MSG_SYNCING: // I'm syncing and this is my MAC address
+    if (g_syncStarted != 0)
+    { // If this device is also syncing
+      onSyncBeacon(*(const sync_beacon_msg *)incomingData);
+    }
+    break;
+  case MSG_PEER_LIST: // This is the list of peers that I have
+    confirmPeerList(mac, *(const peer_list_msg *)incomingData, true);
+    g_log.push(LOG_SYNC_STARTED, g_syncStarted);
+    break;
+  case MSG_PEER_DELTA: // These are the peers you're missing
+    confirmPeerList(mac, *(const peer_list_msg *)incomingData, false);
+    break;
+  case MSG_SET_PLAYER: // A new currentPlayer is being set.
+  {
+    const set_player_msg *setPlayer = (const set_player_msg *)incomingData;
+    if (setPlayer->indicator >= 0) // The indicator is the index of the new current player
+    {
+      g_currentPlayer = setPlayer->address; // the address of the new current player
+      if (g_firstPlayer == DUMMY_ADDRESS)   // If the first player has yet to be set,
+      {                                     // then this is the first player
+        g_firstPlayer = g_currentPlayer;    // so copy the current player to the first player as well
       }
+      checkIfCurrentPlayer(); // Turn the LED on if I'm the current player
+    }
+    break;
+  }
+  case MSG_TURN_ORDER:                                                // A new player has selected their turn order
+    registerTurnOrder(((const address_msg *)incomingData)->address); // register their turn order, and the final player's if they're the last but one
+    break;
+  case MSG_POKE:
+    if (g_currentPlayer == OWN_MAC_ADDRESS)
+    {
+      g_beingBothered = 1;
+    }
+    break;
+  case MSG_PEER_DIGEST: // This is the digest of the peers that I have
+    onPeerDigest(mac, *(const peer_digest_msg *)incomingData);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief check a received frame, count it, and handle each message in it in order
+ * Depends on isValidMessage and handleMessage
+ *
+ */
+void handleFrame(const rx_frame &frame)
+{
+  auto timer = g_timings.time(TIMING_HANDLE_FRAME);
+  MacKey mac = MacKey::fromBytes(frame.mac);
+  const uint8_t *incomingData = frame.data;
+  uint8_t len = frame.length;
+  g_trace.instantAt(frame.time, TRACE_RECEIVE, len, (uint32_t)mac.value);
+  if (!isValidMessage(incomingData, len)) // Drop anything that isn't the size its type says it is
+  {
+    g_log.push(LOG_MALFORMED_FRAME, len, mac);
+    return;
+  }
+  link_counters *peerCounters = g_linkStats.peer(mac);
+  if (peerCounters != NULL)
+  {
+    peerCounters->rxFrames++;
+    peerCounters->rxBytes += len;
+  }
+  g_log.push(LOG_RECEIVING, len, mac);
+  if ((incomingData[0] & MSG_TYPE_MASK) != MSG_BATCH)
+  {
+    handleMessage(mac, incomingData, len, peerCounters);
+    return;
+  }
+  for (uint8_t offset = sizeof(msg_header); offset < len; offset += 1 + incomingData[offset])
+  {
+    handleMessage(mac, incomingData + offset + 1, incomingData[offset], peerCounters);
+  }
+}
+
+/**
+ * @brief handle the frames OnDataRecvd() has queued since the last pass through loop()
+ * Depends on handleFrame
+ *
+ * At most a ring's worth is handled per pass, so a flood of frames can't keep the buttons and the tasks waiting.
+ *
+ */
+void drainReceivedFrames()
+{
+  for (uint16_t i = 0; i < RX_QUEUE_SIZE; i++)
+  {
+    const rx_frame *frame = g_rxFrames.peek();
+    if (frame == NULL)
+    {
       break;
     }
+    handleFrame(*frame);
+    g_rxFrames.pop();
+  }
+  uint32_t drops = g_rxFrames.dropped();
+  if (drops != g_reportedRxDrops && Serial.availableForWrite() >= 80)
+  {
+    Serial.print("****WARNING! RX QUEUE FULL, FRAMES DROPPED: ");
+    Serial.println(drops - g_reportedRxDrops);
+    g_reportedRxDrops = drops;
+  }
+}
+
+/********************************************************************************************************************************************
+ *                           Phases
+ ********************************************************************************************************************************************/
+// Each phase that loop() used to spin in is now a set of tasks on g_scheduler.
+// g_phaseTask polls for the end of the current phase and g_blinkTask runs its LED pattern.
+// When a phase ends it cancels both and schedules the tasks of the next phase, so nothing ever waits in delay().
+
+/**
+ * @brief switch the task that polls for the end of the current phase
+ *
+ */
+void setPhaseTask(uint32_t periodMs, task_callback callback)
+{
+  g_scheduler.cancel(g_phaseTask);
+  g_phaseTask = g_scheduler.every(periodMs, callback);
+}
+
+/**
+ * @brief switch the task that runs the LED pattern of the current phase, or stop it by passing NULL
+ *
+ */
+void setBlinkTask(uint32_t periodMs, task_callback callback)
+{
+  g_scheduler.cancel(g_blinkTask);
+  g_blinkCount = 0;
+  if (callback != NULL)
+  {
+    g_blinkTask = g_scheduler.every(periodMs, callback, periodMs);
+  }
+}
+
+/**
+ * @brief every 500ms while taking turns, poke the first player if both buttons have been held down for 3 seconds
+ *
+ */
+void botherTask()
+{
+  if (g_currentPlayer != OWN_MAC_ADDRESS &&
+      g_buttons.downFor(BUTTON_NEXT) > BOTHER_HOLD_MS && g_buttons.downFor(BUTTON_PREV) > BOTHER_HOLD_MS)
+  {
+    botherFirstPlayer();
+  }
+}
+
+/**
+ * @brief flash the activity LED every 50ms while this device is being bothered
+ *
+ */
+void botheredBlinkTask()
+{
+  // if this device received a new bother command successfully
+  if (g_beingBothered == 1 && g_botheringStarted == 0)
+  {
+    // Set a bothering variable so that we can see if a new bothering command is received later
+    g_botheringStarted = 1;
+    g_beingBothered = 0;
+  }
+  if (g_botheringStarted == 0)
+  {
+    return;
+  }
+  g_ledState = !g_ledState; // 50ms off, 50ms on
+  writeLed(ACTIVITY_LED, g_ledState);
+  if (g_ledState == HIGH)
+  {
+    g_blinkCount++; // increase the count of times we've blinked
+  }
+  if (g_blinkCount > 11) // After 11 blinks, check if we're still being bothered
+  {
+    if (g_beingBothered == 0) // If we've not received a new bother command
+    {                         // End the bothering
+      g_botheringStarted = 0;
+    }
+    else
+    {
+      g_beingBothered = 0; // Otherwise we will keep being bothered, and reset this to prepare to check yet again
+    }
+    g_blinkCount = 0; // reset the count
+  }
+}
+
+/**
+ * @brief while taking turns, each press of next or previous passes the turn once, and holding sync restarts
+ *
+ */
+void takeTurnsButtonHandler(const button_event &event)
+{
+  if (event.button == BUTTON_SYNC && event.type == BUTTON_HELD) // Held down long enough to trigger a restart
+  {
+    Serial.print("Restarting, sync held for: ");
+    Serial.println(event.duration);
+    writeLed(ACTIVITY_LED, LOW);
+    digitalWrite(FLASH_BUTTON, HIGH);
+    writeLed(NODEMCU_LED, HIGH);
+    ESP.restart();
+  }
+  if (event.type != BUTTON_PRESSED || g_currentPlayer != OWN_MAC_ADDRESS)
+  {
+    return; // Only the current player can pass the turn
+  }
+  if (event.button == BUTTON_NEXT)
+  {
+    passTurn(-1);
+  }
+  else if (event.button == BUTTON_PREV)
+  {
+    passTurn(-2);
   }
-  return nextPlayer;
 }
 
-void registerTurnOrder(uint8_t incomingAddress[6])
+/**
+ * @brief Take turns: runs until the device restarts
+ *
+ */
+void startTakingTurns()
+{
+  setLoopPhase(PHASE_TURNS);
+  Serial.println("Current player:");
+  printMacAddress(g_currentPlayer);
+  Serial.println("");
+  checkIfCurrentPlayer(); // Check if we're the current player and turn it back on
+  g_syncStarted = 0;      // reset this before heading into the next section
+  g_botheringStarted = 0;
+  g_buttonHandler = takeTurnsButtonHandler;
+  setBlinkTask(50, botheredBlinkTask);
+  g_scheduler.every(BOTHER_INTERVAL_MS, botherTask);
+}
+
+/**
+ * @brief Wait for all players to choose their order
+ *
+ */
+void waitAllSelectedTask()
 {
-  Serial.print("Registering turn order for");
-  printMacAddress(incomingAddress);
-  Serial.print("at index:");
-  for (int i = 0; i < g_syncedPeers; i++)
-  {                                                            // Loop through the g_tempPeers list
-    if (areMacAddressesEqual(g_tempPeers[i], incomingAddress)) // if the address is already registered, ignore
-    {
-      Serial.print(i);
-      Serial.println(", and it was a duplicate");
-      break;
-    }
-    if (areMacAddressesEqual(g_tempPeers[i], incomingAddress))
-    {
-      Serial.println("Why are we still executing?");
-    }
-    if (areMacAddressesEqual(g_tempPeers[i], DUMMY_ADDRESS)) // When you find an empty index,
-    {                                                        // Copy the incoming address to that index
-      Serial.println(i);
-      copyMacAddress(g_tempPeers[i], incomingAddress);
-      if (i == g_syncedPeers - 1) // If this is the last index, all have been selected
-      {
-        g_allSelected = 1;
-      }
-      if (i == g_syncedPeers - 2) // If we're at the index before the last one, i.e. index 1 (second slot) with 3 total players
-      {                           // Then there's only one peer left to sync. We know who that is, so assign it.
-        for (int j = 0; j < g_syncedPeers; j++)
-        {
-          int found = 0;
-          for (int k = 0; k < g_syncedPeers; k++)
-          {
-            if (areMacAddressesEqual(g_peers[j], g_tempPeers[k])) // For each peer registered, see if they're already in the turn order list
-            {
-              found = 1;
-              break;
-            }
-          }
-          if (found == 0) // If found was not assigned, we know that this peer wasn't in the turn order list
-          {               // So we can assign that peer to the final slot
-            copyMacAddress(g_tempPeers[g_syncedPeers - 1], g_peers[j]);
-            g_allSelected = 1; // And now we know that all players have been selected
-            break;
-          }
-        }
-      }
-      break;
-    }
+  if (!allSelected())
+  {
+    return;
   }
+  g_scheduler.cancel(g_phaseTask);
+  collectTurnOrder();
+  g_peers = g_tempPeers;           // Copy the new turn order into the global list
+  writeLed(ACTIVITY_LED, LOW); // Turn off the LED
+  Serial.println("All done setting order!");
+  g_scheduler.after(1000, startTakingTurns);
 }
 
-void sendAndRegisterTurnOrder(uint8_t addressToSend[6])
+/**
+ * @brief put this device in the turn order lineup next
+ *
+ */
+void chooseTurnOrder()
 {
-  Serial.print("Sending turn order: ");
-  printMacAddress(addressToSend);
-  autosync_send_struct sending = {0};
-  sending.purpose = 4;
-  copyMacAddress(sending.address, addressToSend);
-  lastSentPacket = sendPacket(sending);
-  registerTurnOrder(addressToSend);
+  setLoopPhase(PHASE_WAIT_ALL);
+  g_buttonHandler = NULL;
+  setBlinkTask(0, NULL);
+  sendAndRegisterTurnOrder(OWN_MAC_ADDRESS); // Send a packet to put this device in the turn order lineup next
+  writeLed(ACTIVITY_LED, HIGH);              // Turn the LED on solidly
+  setPhaseTask(ORDER_POLL_MS, waitAllSelectedTask);
 }
 
 /**
- * Send a packet setting a new currentPlayer
- * @param player Set this to -1 for next player, -2 for previous player, or an arbitrary player index number
- *
+ * @brief Player Order Selection: any button press chooses this device as the next player
  *
  */
-void passTurn(int player = -1)
+void orderSelectionButtonHandler(const button_event &event)
 {
-  if (!areMacAddressesEqual(g_currentPlayer, OWN_MAC_ADDRESS)) // If this device isn't the current player
-  {                                                            // Then ignore this button press
-    // g_button_pressed = 0;
-    return;
+  if (event.type == BUTTON_PRESSED)
+  {
+    chooseTurnOrder();
   }
-  // Initialize a packet to send
-  autosync_send_struct sending = {0};
-  sending.purpose = 3;
-  sending.indicator = -1;
-  int nextPlayer = -1;
-  switch (player)
+}
+
+/**
+ * @brief Player Order Selection: the first player, or the last one when everyone else has chosen, doesn't need to
+ * press anything
+ *
+ */
+void orderSelectionTask()
+{
+  if (allSelected() || g_firstPlayer == OWN_MAC_ADDRESS)
   {
-  case -1:
-    nextPlayer = setNextPlayer();
-    break;
-  case -2:
-    nextPlayer = setPrevPlayer();
-    break;
-  default:
-    if (player <= g_syncedPeers) // If the player set is within the bounds of the player count,
-    {                            // send the specified index
-      nextPlayer = player;
-    }
-    else
-    {
-      Serial.print("Cannot set this player: ");
-      Serial.println(player);
-    }
-    break;
+    chooseTurnOrder();
   }
-  if (nextPlayer != -1) // If a player has been set
+}
+
+/**
+ * @brief register the first player and move on to choosing the turn order
+ *
+ */
+void startOrderSelection()
+{
+  setLoopPhase(PHASE_ORDER);
+  registerTurnOrder(g_firstPlayer); // This device has either set the first player or been told who it is
+  for (uint8_t i = 0; i < g_earlyTurnOrderCount; i++) // In the order they arrived
   {
-    sending.indicator = nextPlayer;                       // Send the index number as an indicator
-    copyMacAddress(sending.address, g_peers[nextPlayer]); // Set the address to the next player's address
-    copyMacAddress(g_currentPlayer, g_peers[nextPlayer]); // Set the local current player to the next player's address
-    lastSentPacket = sendPacket(sending);                 // Send the packet
-    checkIfCurrentPlayer();                               // Turn off the LED if this device is no longer the current player
+    registerTurnOrder(g_earlyTurnOrder[i]);
   }
-  else // The parameter was greater than the number of players or less than -2
+  g_earlyTurnOrderCount = 0;
+  g_startSyncTime = millis();
+  g_ownPeerListConfirmed = 1; // This is as good as it gets!
+  setBlinkTask(10, playerCountBlink); // Blink a number of times equal to the current player number being chosen
+  g_buttonHandler = orderSelectionButtonHandler;
+  setPhaseTask(ORDER_POLL_MS, orderSelectionTask);
+}
+
+/**
+ * @brief blink the activity LED 20ms on, 20ms off until the lowest MAC has set the first player
+ *
+ */
+void waitForFirstPlayerTask()
+{
+  if (g_firstPlayer == DUMMY_ADDRESS)
   {
-    Serial.println("Error in setting next player");
+    g_ledState = !g_ledState;
+    writeLed(ACTIVITY_LED, g_ledState);
+    return;
   }
-  // g_button_pressed = 0;
+  g_scheduler.cancel(g_phaseTask);
+  Serial.print("Found first player: ");
+  printMacAddress(g_firstPlayer);
+  g_currentPlayer = g_firstPlayer;
+  checkIfCurrentPlayer();
+  g_scheduler.after(50, startOrderSelection);
 }
 
 void setFirstPlayer()
 {
   Serial.println("");
-  copyMacAddress(g_currentPlayer, g_peers[0]);
+  g_currentPlayer = g_peers.at(0);
   Serial.print("My address: ");
   printMacAddress(OWN_MAC_ADDRESS);
   Serial.println("");
-  if (areMacAddressesEqual(g_currentPlayer, OWN_MAC_ADDRESS)) // If I'm the lowest MAC, randomize and set the first player
+  if (g_currentPlayer == OWN_MAC_ADDRESS) // If I'm the lowest MAC, randomize and set the first player
   {
     Serial.print("Choosing random first player out of: ");
     Serial.println(g_syncedPeers);
     int randomFirstPlayer;
-    randomSeed(*(volatile unsigned long *)0x3FF20E44); // This address has a random value at it.
+    randomSeed(RANDOM_REG32);                          // The hardware random number generator
     for (int i = 0; i < 10; i++)                       // Just to prove it's random for testing
     {
       randomFirstPlayer = (int)random(0, g_syncedPeers); // Pick a random player
       Serial.println(randomFirstPlayer);
     }
     Serial.print("First player: ");
-    printMacAddress(g_peers[randomFirstPlayer]);
-    copyMacAddress(g_firstPlayer, g_peers[randomFirstPlayer]);
+    printMacAddress(g_peers.at(randomFirstPlayer));
+    g_firstPlayer = g_peers.at(randomFirstPlayer);
     passTurn(randomFirstPlayer);
+    checkIfCurrentPlayer();
+    g_scheduler.after(50, startOrderSelection);
   }
   else // Otherwise wait for the lowest MAC to randomize and set first player
   {
     Serial.println("Waiting for first player to be set...");
-    printMacAddress(g_firstPlayer);
-    Serial.println("");
-    g_startSyncTime = millis();
-    while (areMacAddressesEqual(g_firstPlayer, DUMMY_ADDRESS))
-    {
-      yield();
-      if (millis() - g_startSyncTime > 20)
-      {
-        if (millis() - g_startSyncTime > 40)
-        {
-          digitalWrite(ACTIVITY_LED, LOW);
-          g_startSyncTime = millis();
-        }
-        else
-        {
-          digitalWrite(ACTIVITY_LED, HIGH);
-        }
-      }
-    }
-    Serial.print("Found first player: ");
-    printMacAddress(g_firstPlayer);
-    copyMacAddress(g_currentPlayer, g_firstPlayer);
+    setPhaseTask(20, waitForFirstPlayerTask);
   }
-  checkIfCurrentPlayer();
 }
 
+/**
+ * @brief freeze the player count and choose the first player
+ *
+ * g_peers has been kept in ascending order as each address arrived, so every dock already agrees on g_peers.at(0)
+ * without sorting or another round trip.
+ *
+ */
 void initializeFirstPlayer()
 {
-  Serial.println("sortMacAddressArrayList()");
-  sortMacAddressArrayList();
+  setLoopPhase(PHASE_FIRST_PLAYER);
+  g_syncedPeers = g_peers.count();
+  Serial.print("Peers synced: ");
+  Serial.println(g_syncedPeers);
   printPeers(g_peers);
   Serial.println("setFirstPlayer()");
   setFirstPlayer();
 }
 
-void playerCountBlink()
+/**
+ * @brief blink the NodeMCU LED 500ms off, 500ms on while everyone else catches up
+ *
+ */
+void catchUpBlinkTask()
 {
-  unsigned long elapsed = millis() - g_startSyncTime; // Shorthand for the time elapsed since the last blink
-  int nextPlayer = 0;                                 // variable to learn the current number of players
-  for (int i = 0; i < g_syncedPeers; i++)             // Loop through the peers list up to the max peers
-  {
-    if (areMacAddressesEqual(g_tempPeers[i], DUMMY_ADDRESS)) // if you find a peer that is empty
-    {
-      if (elapsed == 2000)
-      {
-        Serial.print("Found an empty peer: ");
-        Serial.println(i);
-      }
-      nextPlayer = i + 1; // the last registered player is the index before that one. Increase it by one to find the next player count instead of the index, increase it by one more to find the next player
-      // Ex: if one player has registered, i will be 1 (index 1 is empty). NextPlayer should be 2, because we're searching for player 2.
-      if (nextPlayer < 2) // if there's an error, set the count to 2, because that's the true minimum
-      {
-        nextPlayer = 2;
-      }
-      break;
-    }
-  }
-  if (elapsed > 1999) // If it's been longer than 2 second, restart the blink
+  g_blinkCount++;
+  writeLed(NODEMCU_LED, g_blinkCount % 2 == 1 ? LOW : HIGH);
+}
+
+/**
+ * @brief end of the catch up window, the peer list is as good as it gets
+ *
+ */
+void finishCatchUp()
+{
+  g_scheduler.cancel(g_phaseTask);
+  g_catchingUp = false;
+  setBlinkTask(0, NULL);
+  writeLed(NODEMCU_LED, HIGH);
+  initializeFirstPlayer(); // If this device is the lowest MAC, set the first player. Otherwise wait for first player
+}
+
+/**
+ * @brief finish catching up as soon as every peer's digest matches ours, or after CATCH_UP_MS if some never do
+ *
+ */
+void catchUpTask()
+{
+  if (allPeerDigestsMatch())
   {
-    if (elapsed == 2000)
-    {
-      Serial.print("Elapsed: ");
-      Serial.println(elapsed);
-      Serial.print("nextPlayer: ");
-      Serial.println(nextPlayer);
-      Serial.print("syncedPeers: ");
-      Serial.println(g_syncedPeers);
-      printPeers(g_tempPeers);
-      Serial.println("");
-    }
-    g_startSyncTime = millis(); // set the startSyncTime to however long ago we started blinking
+    g_log.push(LOG_PEERS_CONVERGED, g_peers.count());
+    finishCatchUp();
   }
-  else
+  else if (millis() - g_startSyncTime >= CATCH_UP_MS)
   {
-    // Blink for 200ms a number of times equal to the current player count
-    // Blink for the first 200ms, then turn off for 200ms
-    if (elapsed > (unsigned long)(199 + (200 * (nextPlayer + 1)))) // if all blinks have taken place in this period
-    {
-      digitalWrite(ACTIVITY_LED, LOW); // ensure the led is off
-    }
-    else
-    {
-      if (elapsed % 400 < 200) // if we're in the first 200ms of this 40ms period, blink
-      {
-        digitalWrite(ACTIVITY_LED, HIGH);
-      }
-      else // otherwise, turn the LED off
-      {
-        digitalWrite(ACTIVITY_LED, LOW);
-      }
-    }
+    finishCatchUp();
   }
 }
-/*
-nextplayer == 3, 1000 == 200 + (200 * (3 + 1))
-0   200   400   600   800   1000   1200   1400   1600   1800   2000
-On--off   on----off   on----off
-*/
 
-void botherFirstPlayer()
+/**
+ * @brief send my peer digest and reconcile with everyone else's, for at most CATCH_UP_MS
+ *
+ */
+void startCatchUp()
 {
-  autosync_send_struct sending = {0};
-  sending.purpose = 5;
-  lastSentPacket = sendPacket(sending);
+  setLoopPhase(PHASE_CATCH_UP);
+  confirmSync();              // Send the digest of my peer list to my peers
+  g_startSyncTime = millis(); // reset the g_startSyncTime
+  g_tempPeers.clear();        // Empty the turn order
+  g_turnOrderChosen = 0;
+  Serial.println("Peer list finally confirmed");
+  writeLed(NODEMCU_LED, LOW);
+  setBlinkTask(500, catchUpBlinkTask);
+  g_blinkCount = 1;
+  setPhaseTask(ORDER_POLL_MS, catchUpTask);
 }
 
-/********************************************************************************************************************************************
- *                           Callbacks
- ********************************************************************************************************************************************/
+/**
+ * @brief the sync button was released: stop broadcasting and switch over to the peers that were heard
+ *
+ */
+void endSync()
+{
+  switchFromBroadcastToPeers();         // Remove the broadcast peer and register the list of peers
+  g_scheduler.after(100, startCatchUp); // Give the new peers a moment before sending to them
+}
 
-// Callback when data is sent
-void OnDataSent(uint8_t *mac_addr, uint8_t sendStatus)
+/**
+ * @brief adapt the beacon interval to the channel and pick a jittered delay until the next beacon
+ *
+ * Beacons are broadcast, and a broadcast is reported as delivered whether anyone heard it or not, so a congested
+ * channel shows up as the beacons we don't hear instead. Every other dock beacons at about our interval, so since our
+ * last beacon we should have heard about one from each peer per interval. Hearing under half of that, or any failed
+ * delivery or refused send, doubles the interval. Otherwise it shrinks by a quarter.
+ * It never drops below SYNC_BEACON_MS_PER_PEER for every dock heard, so a full table doesn't flood the channel.
+ * The delay is uniform over half to one and a half intervals, so docks whose buttons were pressed together drift apart
+ * instead of colliding on every beacon.
+ *
+ */
+uint32_t nextBeaconDelay()
 {
-  char macStr[18];
-  Serial.print("Packet to:");
-  snprintf(macStr, sizeof(macStr), "%02x:%02x:%02x:%02x:%02x:%02x",
-           mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
-  Serial.print(macStr);
-  Serial.print(" send status: ");
-  if (sendStatus == 0)
+  uint32_t now = millis();
+  uint32_t expected = g_peers.count() * (now - g_lastBeaconAt) / g_beaconIntervalMs;
+  boolean missed = g_beaconsHeard * 2 < expected;
+  g_beaconsHeard = 0;
+  g_lastBeaconAt = now;
+  if (missed || g_deliveryFailures != g_beaconFailuresSeen) // Congested, back off
   {
-    Serial.println("Delivery success");
-    g_lastDeliveryFailed = 0;
+    g_beaconIntervalMs *= 2;
+    g_beaconFailuresSeen = g_deliveryFailures;
   }
-  else
+  else // Quiet, speed up
   {
-    Serial.println("Delivery fail");
-    g_lastDeliveryFailed = 1;
+    g_beaconIntervalMs -= g_beaconIntervalMs / 4;
   }
+  uint32_t floorMs = max(SYNC_BEACON_MIN_MS, SYNC_BEACON_MS_PER_PEER * (g_peers.count() + 1));
+  g_beaconIntervalMs = constrain(g_beaconIntervalMs, floorMs, SYNC_BEACON_MAX_MS);
+  return g_beaconIntervalMs / 2 + random(g_beaconIntervalMs);
 }
 
-// Callback function that will be executed when data is received
-void OnDataRecvd(uint8_t *mac, uint8_t *incomingData, uint8_t len)
-{
-  autosync_send_struct receiving;
-  memcpy(&receiving, incomingData, sizeof(receiving));
-  Serial.println("Recieving...");
-  Serial.print("Bytes received: ");
-  Serial.println(len);
-  Serial.print("Purpose received: ");
-  Serial.println(receiving.purpose);
-  Serial.print("Resend: ");
-  Serial.println(receiving.resend);
-  Serial.print("Address received: ");
-  printMacAddress(receiving.address);
-  Serial.println();
+/**
+ * @brief every beacon interval while the sync button is held down, rescheduling itself with a new jittered delay
+ *
+ */
+void beaconTask()
+{
+  Serial.println("Broadcasting Mac address...");
+  sendMacAddress(); // send this unit's MAC address to everyone else (who's syncing)
+  g_beaconTask = g_scheduler.after(nextBeaconDelay(), beaconTask);
+}
 
-  switch (receiving.purpose)
+/**
+ * @brief Initial Sync: start broadcasting when the sync button is pressed, and stop when it's released
+ *
+ */
+void syncButtonHandler(const button_event &event)
+{
+  if (event.button != BUTTON_SYNC)
   {
-  case 1: // I'm syncing and this is my MAC address
-    if (g_syncStarted != 0)
-    { // If this device is also syncing
-      checkAndSyncAddress(receiving);
-    }
-    break;
-  case 2: // This is the list of peers that I have
-    confirmPeerList(receiving);
-    Serial.print("SyncStarted: ");
-    Serial.println(g_syncStarted);
-    break;
-  case 3:                         // A new currentPlayer is being set.
-    if (receiving.indicator >= 0) // The indicator is the index of the new current player
-    {
-      copyMacAddress(g_currentPlayer, receiving.address);     // receiving.address is the address of the new current player
-      if (areMacAddressesEqual(g_firstPlayer, DUMMY_ADDRESS)) // If the first player has yet to be set,
-      {                                                       // then this is the first player
-        copyMacAddress(g_firstPlayer, g_currentPlayer);       // so copy the current player to the first player as well
-      }
-      checkIfCurrentPlayer(); // Turn the LED on if I'm the current player
-    }
-    break;
-  case 4:                                 // A new player has selected their turn order
-    registerTurnOrder(receiving.address); // register their turn order and set g_allSelected to 1 if this is the final player
-    break;
-  case 5:
-    if (areMacAddressesEqual(g_currentPlayer, OWN_MAC_ADDRESS))
-    {
-      g_beingBothered = 1;
-    }
-    break;
-
-  default:
-    break;
+    return;
+  }
+  if (event.type == BUTTON_PRESSED && g_syncStarted == 0) // Sync has not started
+  {
+    g_syncStarted = 1; // Start the sync
+    writeLed(ACTIVITY_LED, HIGH);
+    g_startSyncTime = millis(); // mark the time the sync started
+    g_beaconIntervalMs = SYNC_BEACON_START_MS;
+    g_beaconFailuresSeen = g_deliveryFailures;
+    g_beaconsHeard = 0;
+    g_lastBeaconAt = millis();
+    g_beaconTask = g_scheduler.after(random(SYNC_BEACON_START_MS), beaconTask); // Start at a random phase
+  }
+  else if (event.type == BUTTON_RELEASED && g_syncStarted == 1) // If sync is currently running, run this once
+  {
+    g_syncStarted = 2; // Sync is ending
+    g_buttonHandler = NULL;
+    g_scheduler.cancel(g_beaconTask);
+    writeLed(ACTIVITY_LED, LOW);
+    g_scheduler.after(10, endSync); // Don't crowd the channel
   }
-  Serial.println("Finished receiving data");
 }
 
 /********************************************************************************************************************************************
@@ -1146,7 +3404,10 @@ void setup()
   Serial.println("gamedock");
 
   // set pins
-  pinMode(SYNC_BUTTON, INPUT);
+  g_buttons.begin(BUTTON_SYNC, SYNC_BUTTON, false, RESTART_HOLD_MS);
+  g_buttons.begin(BUTTON_PREV, PREV_BUTTON, false, BOTHER_HOLD_MS);
+  g_buttons.begin(BUTTON_NEXT, NEXT_BUTTON, false, BOTHER_HOLD_MS);
+  g_buttons.begin(BUTTON_FLASH, FLASH_BUTTON, true, 0);
   pinMode(BUILTINLED, OUTPUT);
   digitalWrite(BUILTINLED, HIGH);
   pinMode(NODEMCU_LED, OUTPUT);
@@ -1155,7 +3416,9 @@ void setup()
   Serial.println("Pins set");
 
   // Get own mac address and store in OWN_MAC_ADDRESS
-  WiFi.macAddress(OWN_MAC_ADDRESS);
+  uint8_t ownMac[6];
+  WiFi.macAddress(ownMac);
+  OWN_MAC_ADDRESS = MacKey(ownMac);
   Serial.print("Mac address: ");
   printMacAddress(OWN_MAC_ADDRESS);
   Serial.println(" ");
@@ -1182,11 +3445,17 @@ void setup()
   Serial.println(esp_now_register_send_cb(OnDataSent));
 
   // Register the broadcast peer
-  Serial.print("Peer added with exit code ");
-  Serial.println(esp_now_add_peer(BROADCAST_ADDRESS, ESP_NOW_ROLE_COMBO, WIFI_CHANNEL, NULL, 0));
+  addLinkPeer(BROADCAST_ADDRESS);
+  Serial.println("Broadcast peer added");
 
-  // Attach an interrupt to the sync button to detect the need to restart
-  attachInterrupt(digitalPinToInterrupt(SYNC_BUTTON), syncInterrupt, CHANGE);
+  // Attach an interrupt to each button so they're only looked at when they change
+  attachInterrupt(digitalPinToInterrupt(SYNC_BUTTON), syncButtonInterrupt, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PREV_BUTTON), prevButtonInterrupt, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(NEXT_BUTTON), nextButtonInterrupt, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(FLASH_BUTTON), flashButtonInterrupt, CHANGE);
+
+  // Start in the Initial Sync phase
+  g_buttonHandler = syncButtonHandler;
 }
 
 /********************************************************************************************************************************************
@@ -1195,260 +3464,14 @@ void setup()
 
 void loop()
 {
-  /********************************************************************************************************************************************
-   *                           Initial Sync
-   ********************************************************************************************************************************************/
-
-  while (g_ownPeerListConfirmed == 0)
-  {
-    yield();
-    g_syncButtonState = digitalRead(SYNC_BUTTON); // get the physical sync button's state
-    g_prevButtonState = digitalRead(PREV_BUTTON);
-    g_nextButtonState = digitalRead(NEXT_BUTTON);
-    if (g_syncButtonState != 0) // Sync button held down
-    {
-      if (g_syncStarted == 0) // Sync has not started
-      {
-        g_syncStarted = 1; // Start the sync
-        digitalWrite(ACTIVITY_LED, HIGH);
-        g_startSyncTime = millis(); // mark the time the sync started
-      }
-      else
-      {
-        if ((millis() - g_startSyncTime) > 500 && g_startSyncTime > 0) // every half second after the sync starts
-        {
-          g_startSyncTime = millis();
-          Serial.println("Broadcasting Mac address...");
-          sendMacAddress(); // send this unit's MAC address to everyone else (who's syncing)
-        }
-      }
-    }
-    else // Sync button is not held down
-    {
-      if (g_syncStarted == 1) // If sync is currently running, run this once
-      {
-        g_syncStarted = 2; // Sync is ending
-        digitalWrite(ACTIVITY_LED, LOW);
-        delay(10);                          // Don't crowd the channel
-        switchFromBroadcastToPeers();       // Remove the broadcast peer and register the list of peers
-        confirmSync();                      // Send a copy of my peer list to my peers
-        g_startSyncTime = millis();         // reset the g_startSyncTime
-        for (int i = 0; i < MAX_PEERS; i++) // Empty the tempPeers array
-        {
-          copyMacAddress(g_tempPeers[i], DUMMY_ADDRESS);
-        }
-        Serial.println("Peer list finally confirmed");
-
-        // Delay 3 seconds to let everyone else catch up
-        for (int i = 0; i < 3; i++)
-        {
-          digitalWrite(NODEMCU_LED, LOW);
-          delay(500);
-          digitalWrite(NODEMCU_LED, HIGH);
-          delay(500);
-        }
-
-        initializeFirstPlayer(); // If this device is the lowest MAC, set the first player. Otherwise wait for first player
-        delay(50);
-        registerTurnOrder(g_firstPlayer); // This device has either set
-
-        g_startSyncTime = millis();
-        g_ownPeerListConfirmed = 1; // This is as good as it gets!
-        break;
-      }
-    }
-  }
-
-  /********************************************************************************************************************************************
-   *                           Player Order Selection
-   ********************************************************************************************************************************************/
-  // Loop here while waiting for the player order to initialize
-  // Blink a number of times equal to the current player number being chosen
-  // On any input, if not the first player, send a packet with purpose 4 to register turn order
-  // After this device's order is chosen, put LED on solid
-  while (1 == 1)
-  {
-    yield();                                      // This is required in potentially infinite loops
-    playerCountBlink();                           // Blink to indicate the current player order being chosen
-    g_syncButtonState = digitalRead(SYNC_BUTTON); // get the physical sync button's state
-    g_prevButtonState = digitalRead(PREV_BUTTON); // Any button will do
-    g_nextButtonState = digitalRead(NEXT_BUTTON);
-    if (g_allSelected != 0 || areMacAddressesEqual(g_firstPlayer, OWN_MAC_ADDRESS) || g_syncButtonState != 0 || g_prevButtonState != 0 || g_nextButtonState != 0)
-    {
-      break; // break out of the above while loop
-    }
-  }
-
-  /********************************************************************************************************************************************
-   *                           Wait for all players to choose their order
-   ********************************************************************************************************************************************/
-  sendAndRegisterTurnOrder(OWN_MAC_ADDRESS); // Send a packet to put this device in the turn order lineup next
-  digitalWrite(ACTIVITY_LED, HIGH);          // Turn the LED on solidly
-  while (g_allSelected == 0)                 // Wait here until all are selected
-  {
-    yield(); // This is required in potentially infinite loops
-    g_startSyncTime = millis();
-    if (millis() - g_startSyncTime == 1000)
-    {
-      g_startSyncTime = millis();
-      Serial.print("All selected: ");
-      Serial.println(g_allSelected);
-    }
-  }
-  copyPeers(g_peers, g_tempPeers); // Copy the new turn order into the global list
-  digitalWrite(ACTIVITY_LED, LOW); // Turn off the LED
-  Serial.println("All done setting order!");
-  delay(1000);
-  Serial.println("Current player:");
-  printMacAddress(g_currentPlayer);
-  Serial.println("");
-  checkIfCurrentPlayer();     // Check if we're the current player and turn it back on
-  g_newDurationAvailable = 0; // reset this before listening to the potential reset
-  g_syncStarted = 0;          // reset this before heading into the next section
-  uint8_t botherCount = 0;    // variable for tracking how long we've been bothered
-  int botheringStarted = 0;   // variable to indicate if bothering command was received
-
-  /********************************************************************************************************************************************
-   *                           Take turns
-   ********************************************************************************************************************************************/
-  // If we've synced successfully and set player turn order
-  while (1 == 1)
-  {
-    yield();
-    g_prevButtonState = digitalRead(PREV_BUTTON);
-    g_nextButtonState = digitalRead(NEXT_BUTTON);
-    // If the sync button has been held down, see if it was held
-    // down long enough to trigger a restart (3 seconds)
-    if (g_newDurationAvailable == 1)
-    {
-      g_newDurationAvailable = 0;
-      if (g_duration > 3000 || (g_durationStart != 0 && millis() - g_durationStart > 3000 && millis() - g_durationStart < 3100))
-      {
-        Serial.println("Restarting:");
-        Serial.print("g_duration: ");
-        Serial.println(g_duration);
-        Serial.print("g_durationStart: ");
-        Serial.println(g_durationStart);
-        digitalWrite(ACTIVITY_LED, LOW);
-        digitalWrite(FLASH_BUTTON, HIGH);
-        digitalWrite(NODEMCU_LED, HIGH);
-        ESP.restart();
-      }
-    }
-
-    // If the next button is unpressed, zero its start time
-    if (g_nextButtonState == 0)
-    {
-      g_nextStart = 0;
-    }
-    // if the previous button is unpressed, zero its start time
-    if (g_prevButtonState == 0)
-    {
-      g_prevStart = 0;
-    }
-    // if the next button is pressed and its start time is zero, record a new start time
-    if (g_nextButtonState != 0 && g_nextStart == 0)
-    {
-      g_nextStart = millis();
-      Serial.print("Next pressed: ");
-      Serial.println(g_nextStart);
-    }
-    // if the previous button is pressed and its start time is zero, record a new start time
-    if (g_prevButtonState != 0 && g_prevStart == 0)
-    {
-      g_prevStart = millis();
-      Serial.print("Previous pressed: ");
-      Serial.println(g_prevStart);
-    }
-    // If either the next or previous buttons are held down...
-    if (g_nextStart != 0 || g_prevStart != 0)
-    {
-      // Pass the turn if this device is the current player
-      if (areMacAddressesEqual(g_currentPlayer, OWN_MAC_ADDRESS)) // If this device is the current player
-      {                                                           // Then pass the turn
-        if (g_nextStart != 0)
-        {
-          passTurn(-1);
-        }
-        if (g_prevStart != 0)
-        {
-          passTurn(-2);
-        }
-      }
-      else // if this device wasn't the current player before the button was pressed...
-      {
-        // If both buttons have been held down for more than 3 seconds,
-        // and no more often than every half second,
-        // send a bother command to first player
-        if (millis() % 500 == 0 && millis() - g_nextStart > 3000 && millis() - g_prevStart > 3000)
-        {
-          botherFirstPlayer();
-        }
-      }
-    }
-    // if this device received a new bother command successfully
-    if (g_beingBothered == 1 && botheringStarted == 0)
-    {
-      // Set a local bothering variable so that we can see if a new bothering command is received later
-      botheringStarted = 1;
-      g_beingBothered = 0;
-    }
-    // if bothering has begun
-    if (botheringStarted == 1)
-    {
-      if (millis() - g_startSyncTime > 50)
-      {
-        digitalWrite(ACTIVITY_LED, LOW); // turn off the LED every 50ms (and the first time)
-        if (millis() - g_startSyncTime > 100)
-        {
-          digitalWrite(ACTIVITY_LED, HIGH); // turn off the LED after 100ms (and the first time)
-          g_startSyncTime = millis();       // reset the start time for the LED
-          botherCount++;                    // increase the count of times we've blinked
-        }
-      }
-      if (botherCount > 11) // After 11 blinks, check if we're still being bothered
-      {
-        if (g_beingBothered == 0) // If we've not received a new bother command
-        {                         // End the bothering
-          botheringStarted = 0;
-        }
-        else
-        {
-          g_beingBothered = 0; // Otherwise we will keep being bothered, and reset this to prepare to check yet again
-        }
-        botherCount = 0; // reset the count
-      }
-    }
-
-    /*if (millis() - g_startSyncTime > 1000)
-    {
-      if (g_nextButtonState != 0)
-      {
-        Serial.println(g_nextButtonState);
-        // Serial.println(g_button_pressed);
-        Serial.println(millis() - g_startSyncTime);
-        // if (g_button_pressed == 0)
-        //{
-        g_startSyncTime = millis();
-        // g_button_pressed = 1;
-        passTurn(-1);
-        //}
-      }
-      else
-      {
-        if (g_prevButtonState != 0)
-        {
-          Serial.println(g_prevButtonState);
-          // Serial.println(g_button_pressed);
-          Serial.println(millis() - g_startSyncTime);
-          // if (g_button_pressed == 0)
-          //{
-          g_startSyncTime = millis();
-          // g_button_pressed = 1;
-          passTurn(-2);
-          //}
-        }
-      }
-    }*/
-  }
-}
\ No newline at end of file
+  auto timer = g_timings.time(TIMING_LOOP_SYNC + g_loopPhase);
+  drainReceivedFrames();  // Handle whatever OnDataRecvd() has queued
+  serviceTxQueue();       // Match send results, retransmit, and send the next frame if the radio is free
+  drainLog();             // Print anything that has been logged
+  printTimings();         // Print the next rows of the stats command, if it was typed
+  printLinks();           // and of the links command
+  printTrace();           // and of the trace command
+  readSerialCommands();   // Run anything typed into the serial monitor
+  dispatchButtonEvents(); // Hand any debounced presses to the current phase
+  g_scheduler.run();      // Run whichever tasks of the current phase are due
+}
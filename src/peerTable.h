@@ -0,0 +1,186 @@
+#pragma once
+
+#include <Arduino.h>
+#include "macKey.h"
+
+/**
+ * @brief what PeerTable::insert() did
+ *
+ * PEER_ADDED: the address is new and was appended
+ * PEER_PRESENT: the address was already in the table
+ * PEER_FULL: the address is new but there's no room for it
+ *
+ */
+enum peer_insert_result : uint8_t
+{
+  PEER_ADDED,
+  PEER_PRESENT,
+  PEER_FULL
+};
+
+/**
+ * @brief a list of peers with binary-search lookup by mac address
+ *
+ * at(i) gives the i-th peer of the list. insert() appends, for lists whose order means something like the turn order,
+ * and insertSorted() keeps the list in ascending MacKey order, which every dock computes the same way no matter
+ * which order the addresses arrived in. Alongside the list is a copy of the keys kept in sorted order, so indexOf()
+ * and both inserts only compare keys O(log n) times instead of walking every address.
+ *
+ * @tparam CAPACITY the maximum number of peers
+ */
+template <uint8_t CAPACITY>
+class PeerTable
+{
+public:
+  /**
+   * @brief the number of peers in the table
+   *
+   */
+  uint8_t count() const
+  {
+    return m_count;
+  }
+
+  /**
+   * @brief the peer at a position in the list, which must be below count()
+   *
+   */
+  MacKey at(uint8_t index) const
+  {
+    return m_list[index];
+  }
+
+  /**
+   * @brief find a peer's position in the list
+   *
+   * @return its index, or -1 if it isn't in the table
+   */
+  int indexOf(MacKey key) const
+  {
+    uint8_t position = lowerBound(key);
+    if (position < m_count && m_keys[position] == key)
+    {
+      return m_listIndex[position];
+    }
+    return -1;
+  }
+
+  /**
+   * @brief whether a peer is in the table
+   *
+   */
+  boolean contains(MacKey key) const
+  {
+    return indexOf(key) >= 0;
+  }
+
+  /**
+   * @brief add a peer to the end of the list if it isn't already in the table
+   *
+   */
+  peer_insert_result insert(MacKey key)
+  {
+    uint8_t position = lowerBound(key);
+    if (position < m_count && m_keys[position] == key)
+    {
+      return PEER_PRESENT;
+    }
+    if (m_count >= CAPACITY)
+    {
+      return PEER_FULL;
+    }
+    for (uint8_t i = m_count; i > position; i--) // Make room in the sorted index
+    {
+      m_keys[i] = m_keys[i - 1];
+      m_listIndex[i] = m_listIndex[i - 1];
+    }
+    m_keys[position] = key;
+    m_listIndex[position] = m_count;
+    m_list[m_count] = key;
+    m_count++;
+    return PEER_ADDED;
+  }
+
+  /**
+   * @brief add a peer in ascending order if it isn't already in the table
+   *
+   * Only use this on a table that's only ever been filled by insertSorted(), so the list and the index are the same
+   * order.
+   *
+   */
+  peer_insert_result insertSorted(MacKey key)
+  {
+    uint8_t position = lowerBound(key);
+    if (position < m_count && m_keys[position] == key)
+    {
+      return PEER_PRESENT;
+    }
+    if (m_count >= CAPACITY)
+    {
+      return PEER_FULL;
+    }
+    for (uint8_t i = m_count; i > position; i--)
+    {
+      m_keys[i] = m_keys[i - 1];
+      m_list[i] = m_list[i - 1];
+      m_listIndex[i] = i;
+    }
+    m_keys[position] = key;
+    m_list[position] = key;
+    m_listIndex[position] = position;
+    m_count++;
+    return PEER_ADDED;
+  }
+
+  /**
+   * @brief a hash of the set of peers, the same on every dock that has the same peers whatever order they're listed in
+   *
+   */
+  uint32_t digest() const
+  {
+    uint32_t digest = 2166136261u; // FNV-1a over the keys in ascending order
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+      digest = (digest ^ m_keys[i].hash()) * 16777619u;
+    }
+    return digest;
+  }
+
+  /**
+   * @brief remove every peer
+   *
+   */
+  void clear()
+  {
+    m_count = 0;
+  }
+
+private:
+  /**
+   * @brief the first position in the sorted index whose key isn't less than key
+   *
+   */
+  uint8_t lowerBound(MacKey key) const
+  {
+    uint8_t low = 0;
+    uint8_t high = m_count;
+    while (low < high)
+    {
+      uint8_t middle = (low + high) / 2;
+      if (m_keys[middle] < key)
+      {
+        low = middle + 1;
+      }
+      else
+      {
+        high = middle;
+      }
+    }
+    return low;
+  }
+
+  MacKey m_list[CAPACITY] = {};       // the peers in list order
+  MacKey m_keys[CAPACITY] = {};       // every peer's key, in ascending order
+  uint8_t m_listIndex[CAPACITY] = {}; // m_listIndex[i] is where m_keys[i] is in m_list
+  uint8_t m_count = 0;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief a function run by the Scheduler, takes no parameters and uses globals like the rest of the sketch
+ *
+ */
+typedef void (*task_callback)();
+
+/**
+ * @brief one slot in the Scheduler
+ *
+ * task_callback callback:
+ * The function to run, NULL if this slot is free
+ *
+ * uint32_t due:
+ * millis() when the task runs next
+ *
+ * uint32_t period:
+ * How often a periodic task runs, 0 for a one-shot task
+ *
+ */
+typedef struct scheduled_task
+{
+  task_callback callback;
+  uint32_t due;
+  uint32_t period;
+} scheduled_task;
+
+/**
+ * @brief a cooperative scheduler for periodic and one-shot tasks, run from loop()
+ *
+ * Nothing here blocks: run() calls every task that is due and returns, so LED patterns, button scanning,
+ * retransmits and protocol timeouts all interleave instead of waiting on delay().
+ * Task ids are slot numbers; -1 means "no task" so an id variable can be cancelled safely more than once.
+ *
+ * @tparam SIZE the maximum number of tasks scheduled at once
+ */
+template <uint8_t SIZE>
+class Scheduler
+{
+public:
+  /**
+   * @brief run a task every periodMs
+   *
+   * @param periodMs how often to run it
+   * @param callback the function to run
+   * @param firstDelayMs how long to wait before the first run
+   * @return the task id, or -1 if every slot is taken
+   */
+  int8_t every(uint32_t periodMs, task_callback callback, uint32_t firstDelayMs = 0)
+  {
+    return schedule(callback, firstDelayMs, periodMs);
+  }
+
+  /**
+   * @brief run a task once, delayMs from now
+   *
+   * @return the task id, or -1 if every slot is taken
+   */
+  int8_t after(uint32_t delayMs, task_callback callback)
+  {
+    return schedule(callback, delayMs, 0);
+  }
+
+  /**
+   * @brief stop a task from running again and set its id to -1
+   *
+   */
+  void cancel(int8_t &taskId)
+  {
+    if (taskId >= 0 && taskId < SIZE)
+    {
+      m_tasks[taskId].callback = NULL;
+    }
+    taskId = -1;
+  }
+
+  /**
+   * @brief run every task that is due, called on every pass through loop()
+   *
+   * A periodic task that fell more than a period behind skips the missed runs rather than running in a burst.
+   */
+  void run()
+  {
+    for (uint8_t i = 0; i < SIZE; i++)
+    {
+      scheduled_task &task = m_tasks[i];
+      uint32_t now = millis();
+      if (task.callback == NULL || (int32_t)(now - task.due) < 0)
+      {
+        continue;
+      }
+      task_callback callback = task.callback;
+      if (task.period == 0)
+      {
+        task.callback = NULL; // Free the slot first so the task can schedule itself again
+      }
+      else
+      {
+        task.due += task.period;
+        if ((int32_t)(now - task.due) >= 0)
+        {
+          task.due = now + task.period;
+        }
+      }
+      callback();
+    }
+  }
+
+private:
+  int8_t schedule(task_callback callback, uint32_t delayMs, uint32_t periodMs)
+  {
+    for (uint8_t i = 0; i < SIZE; i++)
+    {
+      if (m_tasks[i].callback == NULL)
+      {
+        m_tasks[i].callback = callback;
+        m_tasks[i].due = millis() + delayMs;
+        m_tasks[i].period = periodMs;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  scheduled_task m_tasks[SIZE] = {};
+};
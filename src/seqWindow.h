@@ -0,0 +1,212 @@
+#pragma once
+
+#include <Arduino.h>
+#include "macKey.h"
+
+/**
+ * @brief how far behind the newest sequence number a frame can be and still be told apart from a duplicate
+ *
+ * Every sender numbers all its messages from one counter, and a reliable message can still be retried after newer ones
+ * have gone out. This covers the transmit queue's depth times its retry budget, 8 slots of up to 6 attempts each.
+ *
+ */
+static const uint8_t SEQ_WINDOW_BITS = 64;
+
+/**
+ * @brief how long a sender can be quiet before its window is forgotten, so a dock that rebooted and started
+ * its sequence numbers over isn't ignored
+ *
+ */
+static const uint32_t SEQ_WINDOW_EXPIRE_MS = 10000;
+
+/**
+ * @brief what DuplicateFilter::check() decided about a frame
+ *
+ * SEQ_NEW: first time this sequence number has been seen from this sender, handle it
+ * SEQ_DUPLICATE: already seen, a retransmit of something that was handled
+ * SEQ_STALE: too far behind the newest frame from this sender to tell, it's up to the caller whether to handle it
+ *
+ */
+enum seq_verdict : uint8_t
+{
+  SEQ_NEW,
+  SEQ_DUPLICATE,
+  SEQ_STALE
+};
+
+/**
+ * @brief drops repeated frames before they're dispatched, using a sliding bitmap of seen sequence numbers per sender
+ *
+ * Each sender gets the newest sequence number seen from it and a bitmap of which of the SEQ_WINDOW_BITS numbers
+ * before that have arrived. Checking a frame is a shift and a mask, so a reliable message that was retransmitted
+ * because an OnDataSent() result was lost runs its handler exactly once.
+ * Sequence numbers are 8 bits and wrap, so "newer" means less than half the number space ahead.
+ *
+ * Every frame is checked, so the windows are an open addressed hash table on MacKey::hash() with twice as many slots
+ * as senders. Finding a sender is a probe or two instead of a scan of every window.
+ *
+ * @tparam SENDERS the number of senders tracked at once, the one heard from longest ago is replaced when full
+ */
+template <uint8_t SENDERS>
+class DuplicateFilter
+{
+public:
+  /**
+   * @brief decide whether a frame is new and record it as seen
+   *
+   * @param mac the sender
+   * @param seq the frame's sequence number
+   */
+  seq_verdict check(MacKey mac, uint8_t seq)
+  {
+    uint32_t now = millis();
+    seq_window *window = find(mac);
+    if (window == NULL || now - window->lastSeen > SEQ_WINDOW_EXPIRE_MS)
+    {
+      window = window != NULL ? window : add(mac, now);
+      window->lastSeen = now;
+      window->newest = seq;
+      window->seen = 1;
+      return SEQ_NEW;
+    }
+    window->lastSeen = now;
+    int8_t ahead = (int8_t)(seq - window->newest);
+    if (ahead > 0) // Slide the window forward, the new frame becomes bit 0
+    {
+      window->seen = ahead >= SEQ_WINDOW_BITS ? 0 : window->seen << ahead;
+      window->seen |= 1;
+      window->newest = seq;
+      return SEQ_NEW;
+    }
+    uint8_t behind = -ahead;
+    if (behind >= SEQ_WINDOW_BITS)
+    {
+      return SEQ_STALE;
+    }
+    uint64_t bit = (uint64_t)1 << behind;
+    if (window->seen & bit)
+    {
+      return SEQ_DUPLICATE;
+    }
+    window->seen |= bit; // Arrived late but hasn't been seen yet
+    return SEQ_NEW;
+  }
+
+  /**
+   * @brief forget every sender
+   *
+   */
+  void clear()
+  {
+    for (uint8_t i = 0; i < SLOTS; i++)
+    {
+      m_windows[i].used = false;
+    }
+    m_count = 0;
+  }
+
+  /**
+   * @brief the number of senders being tracked
+   *
+   */
+  uint8_t count() const
+  {
+    return m_count;
+  }
+
+private:
+  static const uint8_t SLOTS = SENDERS * 2; // Keeps the probes short even when every sender is tracked
+  static_assert(SENDERS <= UINT8_MAX / 2, "The slots are counted in a uint8_t");
+
+  typedef struct seq_window
+  {
+    MacKey mac;
+    boolean used;
+    uint8_t newest;   // the newest sequence number seen
+    uint64_t seen;    // bit n set means newest - n has been seen
+    uint32_t lastSeen;
+  } seq_window;
+
+  static uint8_t home(MacKey mac)
+  {
+    return (uint8_t)(((uint64_t)mac.hash() * SLOTS) >> 32);
+  }
+
+  static uint8_t next(uint8_t slot)
+  {
+    return slot + 1 == SLOTS ? 0 : slot + 1;
+  }
+
+  /**
+   * @brief the sender's window, or NULL if it isn't tracked
+   *
+   */
+  seq_window *find(MacKey mac)
+  {
+    for (uint8_t slot = home(mac); m_windows[slot].used; slot = next(slot))
+    {
+      if (m_windows[slot].mac == mac)
+      {
+        return &m_windows[slot];
+      }
+    }
+    return NULL;
+  }
+
+  /**
+   * @brief start tracking a sender, replacing the one heard from longest ago if SENDERS are already tracked
+   *
+   */
+  seq_window *add(MacKey mac, uint32_t now)
+  {
+    if (m_count == SENDERS)
+    {
+      uint8_t oldest = SLOTS;
+      for (uint8_t slot = 0; slot < SLOTS; slot++)
+      {
+        if (!m_windows[slot].used)
+        {
+          continue;
+        }
+        if (oldest == SLOTS || now - m_windows[slot].lastSeen > now - m_windows[oldest].lastSeen)
+        {
+          oldest = slot;
+        }
+      }
+      remove(oldest);
+    }
+    uint8_t slot = home(mac);
+    while (m_windows[slot].used)
+    {
+      slot = next(slot);
+    }
+    m_windows[slot].mac = mac;
+    m_windows[slot].used = true;
+    m_count++;
+    return &m_windows[slot];
+  }
+
+  /**
+   * @brief empty a slot, moving back any window after it that would otherwise be cut off from its home slot
+   *
+   */
+  void remove(uint8_t hole)
+  {
+    m_windows[hole].used = false;
+    m_count--;
+    for (uint8_t slot = next(hole); m_windows[slot].used; slot = next(slot))
+    {
+      uint8_t fromHome = (slot + SLOTS - home(m_windows[slot].mac)) % SLOTS;
+      uint8_t fromHole = (slot + SLOTS - hole) % SLOTS;
+      if (fromHome >= fromHole) // Its home is at or before the hole, so the hole would end its probe early
+      {
+        m_windows[hole] = m_windows[slot];
+        m_windows[slot].used = false;
+        hole = slot;
+      }
+    }
+  }
+
+  seq_window m_windows[SLOTS] = {};
+  uint8_t m_count = 0;
+};
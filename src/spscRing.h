@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief a lock-free single-producer/single-consumer ring of fixed-size records
+ *
+ * push() takes constant time and never blocks, so it's safe to call from the WiFi callbacks and from an ISR
+ * as long as only one context pushes to a given ring. peek()/pop() are only called from loop(), the one consumer.
+ * When the ring is full the new record is thrown away and counted in dropped().
+ *
+ * @tparam T the record type, copied in and out by value
+ * @tparam SIZE the number of records, must be a power of two
+ */
+template <typename T, uint16_t SIZE>
+class SpscRing
+{
+  static_assert((SIZE & (SIZE - 1)) == 0, "SpscRing SIZE must be a power of two");
+
+public:
+  /**
+   * @brief claim the next free slot to fill in, or count a drop if the ring is full
+   *
+   * Fill in the record, then call commit() to hand it to the consumer.
+   *
+   * @return NULL if the ring is full
+   */
+  IRAM_ATTR T *claim()
+  {
+    uint16_t head = __atomic_load_n(&m_head, __ATOMIC_RELAXED);
+    if ((uint16_t)(head - __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE)) >= SIZE)
+    {
+      m_dropped++;
+      return NULL;
+    }
+    return &m_records[head & (SIZE - 1)];
+  }
+
+  /**
+   * @brief publish the slot returned by the last claim()
+   *
+   */
+  IRAM_ATTR void commit()
+  {
+    __atomic_store_n(&m_head, (uint16_t)(m_head + 1), __ATOMIC_RELEASE);
+  }
+
+  /**
+   * @brief copy a record in
+   *
+   * @return false if the record was dropped
+   */
+  IRAM_ATTR bool push(const T &record)
+  {
+    T *slot = claim();
+    if (slot == NULL)
+    {
+      return false;
+    }
+    *slot = record;
+    commit();
+    return true;
+  }
+
+  /**
+   * @brief look at the oldest record without removing it
+   *
+   * @return NULL if the ring is empty
+   */
+  const T *peek() const
+  {
+    uint16_t tail = __atomic_load_n(&m_tail, __ATOMIC_RELAXED);
+    if (tail == __atomic_load_n(&m_head, __ATOMIC_ACQUIRE))
+    {
+      return NULL;
+    }
+    return &m_records[tail & (SIZE - 1)];
+  }
+
+  /**
+   * @brief remove the oldest record after it has been handled
+   *
+   */
+  void pop()
+  {
+    __atomic_store_n(&m_tail, (uint16_t)(m_tail + 1), __ATOMIC_RELEASE);
+  }
+
+  /**
+   * @brief the total number of records thrown away because the ring was full
+   *
+   */
+  uint32_t dropped() const
+  {
+    return m_dropped;
+  }
+
+private:
+  T m_records[SIZE];
+  volatile uint16_t m_head = 0; // next slot to write, only changed by the producer
+  volatile uint16_t m_tail = 0; // next slot to read, only changed by the consumer
+  volatile uint32_t m_dropped = 0;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief how many times a piece of code has run and how long it took, in CPU cycles
+ *
+ * uint32_t count:
+ * How many times it ran since the last reset
+ *
+ * uint32_t minCycles, maxCycles:
+ * The fastest and slowest run, minCycles is UINT32_MAX until the first run
+ *
+ * uint64_t totalCycles:
+ * Every run added together, for the mean
+ *
+ */
+typedef struct timing_stat
+{
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+} timing_stat;
+
+/**
+ * @brief min/max/mean timers for the hot paths, cheap enough to leave in every build
+ *
+ * Timing is two reads of the cycle counter and a handful of adds and compares, well under a microsecond at 80MHz,
+ * so it's safe in the WiFi callbacks. Each timer is only recorded from one context, and a reader in loop() can at
+ * worst see a count and a total that are one run apart, which doesn't matter for a mean.
+ *
+ * @tparam SIZE the number of timers, ids are 0 to SIZE - 1
+ */
+template <uint8_t SIZE>
+class TimingStats
+{
+public:
+  /**
+   * @brief records the time from its construction to the end of its scope, however the scope is left
+   *
+   */
+  class Scope
+  {
+  public:
+    IRAM_ATTR Scope(TimingStats &stats, uint8_t id) : m_stats(stats), m_id(id), m_start(ESP.getCycleCount())
+    {
+    }
+
+    IRAM_ATTR ~Scope()
+    {
+      m_stats.record(m_id, ESP.getCycleCount() - m_start);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    TimingStats &m_stats;
+    uint8_t m_id;
+    uint32_t m_start;
+  };
+
+  TimingStats()
+  {
+    reset();
+  }
+
+  /**
+   * @brief time the rest of the caller's scope: auto timer = g_timings.time(TIMING_PASS_TURN);
+   *
+   */
+  IRAM_ATTR Scope time(uint8_t id)
+  {
+    return Scope(*this, id);
+  }
+
+  /**
+   * @brief add one run that took cycles
+   *
+   */
+  IRAM_ATTR void record(uint8_t id, uint32_t cycles)
+  {
+    timing_stat &stat = m_stats[id];
+    stat.count++;
+    stat.totalCycles += cycles;
+    if (cycles < stat.minCycles)
+    {
+      stat.minCycles = cycles;
+    }
+    if (cycles > stat.maxCycles)
+    {
+      stat.maxCycles = cycles;
+    }
+  }
+
+  const timing_stat &at(uint8_t id) const
+  {
+    return m_stats[id];
+  }
+
+  /**
+   * @brief forget every run so far
+   *
+   */
+  void reset()
+  {
+    for (uint8_t i = 0; i < SIZE; i++)
+    {
+      m_stats[i] = {0, UINT32_MAX, 0, 0};
+    }
+  }
+
+private:
+  timing_stat m_stats[SIZE];
+};
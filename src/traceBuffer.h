@@ -0,0 +1,182 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief what a trace record marks
+ *
+ * TRACE_BEGIN, TRACE_END: the start and end of a span, which nest like function calls
+ * TRACE_INSTANT: something that happened at one moment
+ *
+ */
+enum trace_kind : uint8_t
+{
+  TRACE_BEGIN,
+  TRACE_END,
+  TRACE_INSTANT
+};
+
+/**
+ * @brief one trace record, 12 bytes
+ *
+ * uint32_t time:
+ * micros() when it was recorded
+ *
+ * uint8_t event:
+ * Which event, an index into the caller's table of names
+ *
+ * uint16_t arg, uint32_t value:
+ * Two numbers that say more about the event, such as a purpose and a sequence number
+ *
+ */
+typedef struct trace_record
+{
+  uint32_t time;
+  trace_kind kind;
+  uint8_t event;
+  uint16_t arg;
+  uint32_t value;
+} trace_record;
+
+/**
+ * @brief a flight recorder: spans and instant events with microsecond timestamps in a fixed RAM buffer
+ *
+ * When the buffer is full the oldest record is overwritten, so it always holds the moments before something went
+ * wrong. Recording is a micros() call and a 12 byte copy, and can be paused so a dump isn't overwritten while it's
+ * being printed. Like the log, it's only written from loop(): the WiFi callbacks queue the time something happened,
+ * and loop() records it later with instantAt(). Records are kept in the order they were made, so one made with
+ * instantAt() can be older than the one before it.
+ *
+ * @tparam SIZE the number of records, must be a power of two
+ */
+template <uint16_t SIZE>
+class TraceBuffer
+{
+  static_assert((SIZE & (SIZE - 1)) == 0, "TraceBuffer SIZE must be a power of two");
+
+public:
+  /**
+   * @brief records the begin of a span at its construction and the end when its scope is left
+   *
+   */
+  class Span
+  {
+  public:
+    Span(TraceBuffer &buffer, uint8_t event, uint16_t arg, uint32_t value) : m_buffer(buffer), m_event(event), m_arg(arg), m_value(value)
+    {
+      m_buffer.record(TRACE_BEGIN, m_event, m_arg, m_value);
+    }
+
+    ~Span()
+    {
+      m_buffer.record(TRACE_END, m_event, m_arg, m_value);
+    }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+  private:
+    TraceBuffer &m_buffer;
+    uint8_t m_event;
+    uint16_t m_arg;
+    uint32_t m_value;
+  };
+
+  /**
+   * @brief trace the rest of the caller's scope as a span: auto span = g_trace.span(TRACE_RECEIVE, type, seq);
+   *
+   */
+  Span span(uint8_t event, uint16_t arg = 0, uint32_t value = 0)
+  {
+    return Span(*this, event, arg, value);
+  }
+
+  /**
+   * @brief record something that happened now
+   *
+   */
+  void instant(uint8_t event, uint16_t arg = 0, uint32_t value = 0)
+  {
+    record(TRACE_INSTANT, event, arg, value);
+  }
+
+  /**
+   * @brief record something that happened earlier, at a micros() time the caller kept, so it's traced when it
+   * happened rather than when it was got round to
+   *
+   */
+  void instantAt(uint32_t time, uint8_t event, uint16_t arg = 0, uint32_t value = 0)
+  {
+    recordAt(time, TRACE_INSTANT, event, arg, value);
+  }
+
+  void record(trace_kind kind, uint8_t event, uint16_t arg, uint32_t value)
+  {
+    recordAt(micros(), kind, event, arg, value);
+  }
+
+  void recordAt(uint32_t time, trace_kind kind, uint8_t event, uint16_t arg, uint32_t value)
+  {
+    if (m_paused)
+    {
+      return;
+    }
+    trace_record &record = m_records[m_next & (SIZE - 1)];
+    record.time = time;
+    record.kind = kind;
+    record.event = event;
+    record.arg = arg;
+    record.value = value;
+    m_next++;
+  }
+
+  /**
+   * @brief the number of records held, at most SIZE
+   *
+   */
+  uint16_t count() const
+  {
+    return m_next < SIZE ? m_next : SIZE;
+  }
+
+  /**
+   * @brief the number of records that have been overwritten since the last clear()
+   *
+   */
+  uint32_t overwritten() const
+  {
+    return m_next - count();
+  }
+
+  /**
+   * @brief the index-th record held, oldest first
+   *
+   */
+  const trace_record &at(uint16_t index) const
+  {
+    return m_records[(m_next - count() + index) & (SIZE - 1)];
+  }
+
+  /**
+   * @brief stop or restart recording, everything recorded while paused is thrown away
+   *
+   */
+  void pause(boolean paused)
+  {
+    m_paused = paused;
+  }
+
+  /**
+   * @brief throw away every record
+   *
+   */
+  void clear()
+  {
+    m_next = 0;
+  }
+
+private:
+  trace_record m_records[SIZE];
+  uint32_t m_next = 0;
+  boolean m_paused = false;
+};
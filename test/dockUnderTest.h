@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * @brief the firmware as one dock on the host, for the unit tests
+ *
+ * The same build as the native bench: the simulator's copy of the firmware in namespace gamedock, with the
+ * simulator's Arduino and esp now stand-ins. Run anything that calls millis() or sends through runAsDock().
+ *
+ */
+
+#define GAMEDOCK_SIM // The firmware's TUNABLE constants become variables
+
+#include "../sim/sim.h"
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#include <vector>
+#include "logRing.h"
+#include "scheduler.h"
+#include "buttons.h"
+#include "macKey.h"
+#include "seqWindow.h"
+#include "peerTable.h"
+#include "bloomFilter.h"
+#include "timingStats.h"
+#include "linkStats.h"
+#include "traceBuffer.h"
+#include <functional>
+
+static void tuneValue(uint32_t &constant, uint32_t &value)
+{
+  if (value != SIM_TUNING_UNSET)
+  {
+    constant = value;
+  }
+  value = constant;
+}
+
+#define SIM_DOCK gamedock
+#include "../sim/dockInstance.h"
+
+const sim_dock_api SIM_DOCKS[SIM_MAX_DOCKS] = {gamedock::SIM_API};
+
+/**
+ * @brief the simulator the dock lives in, which is never started, so time only passes through advanceClock()
+ *
+ */
+static Simulator &testSimulator()
+{
+  static sim_config config;
+  static Simulator simulator(config);
+  return simulator;
+}
+
+/**
+ * @brief run some code as the dock
+ *
+ */
+static void runAsDock(const std::function<void()> &code)
+{
+  testSimulator().runAs(0, code);
+}
+
+/**
+ * @brief move the dock's clock on, for anything timed against millis()
+ *
+ */
+static void advanceClock(uint32_t ms)
+{
+  testSimulator().runUntil(testSimulator().now() + (uint64_t)ms * 1000);
+}
@@ -0,0 +1,140 @@
+/**
+ * @brief packing queued messages into one batch frame, unpacking it on arrival, and rejecting malformed batches
+ *
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "../dockUnderTest.h"
+
+using namespace gamedock;
+
+static const MacKey PEERS[] = {MacKey(0x5CCF7F000001ull), MacKey(0x5CCF7F000002ull), MacKey(0x5CCF7F000003ull),
+                               MacKey(0x5CCF7F000004ull)};
+static const MacKey SENDER = PEERS[1];
+
+/**
+ * @brief one link peer, nothing queued, and four peers choosing their turns, with the first already chosen
+ *
+ */
+void setUp()
+{
+  runAsDock([] {
+    clearLinkPeers();
+    addLinkPeer(SENDER);
+    TX_BATCH_WINDOW_MS = 0;
+    memset(&g_txBatch, 0, sizeof(g_txBatch));
+    g_seenFrames.clear();
+    g_peers.clear();
+    for (MacKey peer : PEERS)
+    {
+      g_peers.insertSorted(peer);
+    }
+    g_loopPhase = PHASE_ORDER;
+    g_syncedPeers = 4;
+    g_turnOrderChosen = 0;
+    registerTurnOrder(PEERS[0]);
+  });
+}
+
+void tearDown()
+{
+}
+
+/**
+ * @brief the length of the batch in g_txBatch, up to the first zero length record
+ *
+ */
+static uint8_t batchLength()
+{
+  uint8_t offset = 0;
+  while (offset < sizeof(g_txBatch.records) && g_txBatch.records[offset] != 0)
+  {
+    offset += 1 + g_txBatch.records[offset];
+  }
+  return sizeof(msg_header) + offset;
+}
+
+/**
+ * @brief a frame as OnDataRecvd() would have queued it
+ *
+ */
+static rx_frame receivedFrame(MacKey from, const uint8_t *data, uint8_t length)
+{
+  rx_frame frame = {};
+  from.toBytes(frame.mac);
+  frame.length = length;
+  memcpy(frame.data, data, length);
+  return frame;
+}
+
+void test_messages_queued_together_are_packed_in_order()
+{
+  runAsDock([] {
+    autosync_packet first = makeAddressPacket(MSG_TURN_ORDER, PEERS[2]);
+    autosync_packet second = makeAddressPacket(MSG_TURN_ORDER, PEERS[3]);
+    sendPacket(first, true);
+    sendPacket(second, true);
+    serviceTxQueue();
+    TEST_ASSERT_EQUAL(MSG_BATCH, g_txBatch.header.type);
+
+    const uint8_t *record = g_txBatch.records;
+    const autosync_packet *sent[] = {&first, &second};
+    for (const autosync_packet *packet : sent)
+    {
+      TEST_ASSERT_EQUAL(sizeof(address_msg), record[0]);
+      TEST_ASSERT_EQUAL(MSG_TURN_ORDER, record[1] & MSG_TYPE_MASK);
+      const address_msg *message = (const address_msg *)(record + 1);
+      TEST_ASSERT_TRUE((MacKey)message->address == (MacKey)packet->addressMsg.address);
+      record += 1 + record[0];
+    }
+    TEST_ASSERT_EQUAL(g_txBatch.header.seq, g_txBatch.records[1 + offsetof(msg_header, seq)]); // The first one's
+    TEST_ASSERT_TRUE(isValidMessage((const uint8_t *)&g_txBatch, batchLength()));
+  });
+}
+
+void test_received_batch_is_handled_message_by_message()
+{
+  runAsDock([] {
+    sendPacket(makeAddressPacket(MSG_TURN_ORDER, PEERS[2]), true);
+    sendPacket(makeAddressPacket(MSG_TURN_ORDER, PEERS[3]), true);
+    serviceTxQueue();
+    handleFrame(receivedFrame(SENDER, (const uint8_t *)&g_txBatch, batchLength()));
+    TEST_ASSERT_EQUAL(4, turnOrderCount());
+    TEST_ASSERT_EQUAL(2, g_turnOrder[1]);
+    TEST_ASSERT_EQUAL(3, g_turnOrder[2]);
+  });
+}
+
+void test_malformed_batches_are_rejected()
+{
+  autosync_packet turn = makeAddressPacket(MSG_TURN_ORDER, PEERS[2]);
+  uint8_t frame[ESPNOW_MAX_FRAME] = {MSG_BATCH, 1};
+  uint8_t length = sizeof(msg_header);
+  TEST_ASSERT_FALSE(isValidMessage(frame, length)); // Empty
+
+  frame[length++] = turn.length;
+  memcpy(frame + length, turn.bytes, turn.length);
+  length += turn.length;
+  TEST_ASSERT_TRUE(isValidMessage(frame, length));
+  TEST_ASSERT_FALSE(isValidMessage(frame, length - 1)); // The last record runs past the end
+
+  frame[length] = 0;
+  TEST_ASSERT_FALSE(isValidMessage(frame, length + 1)); // A zero length record
+
+  uint8_t nested[ESPNOW_MAX_FRAME] = {MSG_BATCH, 2, (uint8_t)length};
+  memcpy(nested + 3, frame, length);
+  TEST_ASSERT_FALSE(isValidMessage(nested, length + 3)); // Batches don't nest
+
+  frame[sizeof(msg_header)] = turn.length - 1;
+  TEST_ASSERT_FALSE(isValidMessage(frame, length - 1)); // A record too short for its type
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_messages_queued_together_are_packed_in_order);
+  RUN_TEST(test_received_batch_is_handled_message_by_message);
+  RUN_TEST(test_malformed_batches_are_rejected);
+  return UNITY_END();
+}
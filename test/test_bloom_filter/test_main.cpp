@@ -0,0 +1,100 @@
+/**
+ * @brief the Bloom filter sync beacons carry: never a false negative, and false positives near the stated rate
+ *
+ */
+
+#include <unity.h>
+#include "../dockUnderTest.h"
+
+/**
+ * @brief the beacon's filter, filled to the table's capacity
+ *
+ */
+typedef BloomFilter<16> beacon_filter;
+
+static uint32_t g_random = 0x2545F491;
+
+/**
+ * @brief a random address in the esp8266's vendor prefix, like the docks' own
+ *
+ */
+static MacKey randomMac()
+{
+  g_random ^= g_random << 13; // xorshift32
+  g_random ^= g_random >> 17;
+  g_random ^= g_random << 5;
+  return MacKey(0x5CCF7F000000ull | (g_random & 0xFFFFFF));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_empty_filter_contains_nothing()
+{
+  beacon_filter filter;
+  filter.clear();
+  for (uint16_t i = 0; i < 1000; i++)
+  {
+    TEST_ASSERT_FALSE(filter.mightContain(randomMac()));
+  }
+}
+
+void test_every_address_added_is_found()
+{
+  for (uint16_t trial = 0; trial < 1000; trial++)
+  {
+    beacon_filter filter;
+    filter.clear();
+    MacKey added[gamedock::MAX_PEERS];
+    for (uint8_t i = 0; i < gamedock::MAX_PEERS; i++)
+    {
+      added[i] = randomMac();
+      filter.add(added[i]);
+      for (uint8_t j = 0; j <= i; j++) // Still found after every later add
+      {
+        TEST_ASSERT_TRUE(filter.mightContain(added[j]));
+      }
+    }
+  }
+}
+
+void test_false_positives_stay_near_the_stated_rate()
+{
+  uint32_t positives = 0, probes = 0;
+  for (uint16_t trial = 0; trial < 200; trial++)
+  {
+    beacon_filter filter;
+    filter.clear();
+    PeerTable<gamedock::MAX_PEERS> added;
+    while (added.count() < gamedock::MAX_PEERS)
+    {
+      MacKey mac = randomMac();
+      added.insert(mac);
+      filter.add(mac);
+    }
+    for (uint16_t i = 0; i < 100; i++)
+    {
+      MacKey mac = randomMac();
+      if (!added.contains(mac))
+      {
+        positives += filter.mightContain(mac);
+        probes++;
+      }
+    }
+  }
+  TEST_ASSERT_TRUE(positives * 100 < probes * 10); // About 5% for 20 addresses in 16 bytes
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_filter_contains_nothing);
+  RUN_TEST(test_every_address_added_is_found);
+  RUN_TEST(test_false_positives_stay_near_the_stated_rate);
+  return UNITY_END();
+}
@@ -0,0 +1,131 @@
+/**
+ * @brief Buttons' debouncing: one press and one release per physical press however much the contacts chatter
+ *
+ */
+
+#include <unity.h>
+#include "../dockUnderTest.h"
+
+static const uint8_t PIN = 14;
+static const uint32_t HOLD_MS = 500;
+
+static Buttons<1> g_testButtons;
+
+/**
+ * @brief one active low button with a hold time, up
+ *
+ */
+void setUp()
+{
+  runAsDock([] {
+    g_testButtons = Buttons<1>();
+    g_testButtons.begin(0, PIN, true, HOLD_MS);
+  });
+}
+
+void tearDown()
+{
+}
+
+/**
+ * @brief move the pin to a level and run its interrupt, as a contact closing or opening does
+ *
+ */
+static void edge(boolean down)
+{
+  runAsDock([down] {
+    digitalWrite(PIN, down ? LOW : HIGH);
+    g_testButtons.onEdge(0);
+  });
+}
+
+/**
+ * @brief chatter for a few ms and settle with the button down or up
+ *
+ */
+static void bounceTo(boolean down)
+{
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    edge(down);
+    advanceClock(1);
+    edge(!down);
+    advanceClock(1);
+  }
+  edge(down);
+}
+
+/**
+ * @brief whether nextEvent() has anything, as loop() calls it
+ *
+ */
+static boolean poll(button_event &event)
+{
+  boolean any = false;
+  runAsDock([&] { any = g_testButtons.nextEvent(event); });
+  return any;
+}
+
+void test_chatter_is_one_press_once_settled()
+{
+  button_event event;
+  bounceTo(true);
+  TEST_ASSERT_FALSE(poll(event));
+  advanceClock(DEBOUNCE_MS - 1);
+  TEST_ASSERT_FALSE(poll(event)); // Not quiet for long enough yet
+  advanceClock(1);
+  TEST_ASSERT_TRUE(poll(event));
+  TEST_ASSERT_EQUAL(BUTTON_PRESSED, event.type);
+  TEST_ASSERT_EQUAL(0, event.button);
+  TEST_ASSERT_FALSE(poll(event));
+}
+
+void test_chatter_that_ends_where_it_started_is_nothing()
+{
+  button_event event;
+  bounceTo(false);
+  advanceClock(DEBOUNCE_MS);
+  TEST_ASSERT_FALSE(poll(event));
+  runAsDock([] { TEST_ASSERT_FALSE(g_testButtons.isDown(0)); });
+}
+
+void test_release_reports_how_long_it_was_down()
+{
+  button_event event;
+  bounceTo(true);
+  advanceClock(DEBOUNCE_MS);
+  TEST_ASSERT_TRUE(poll(event));
+  advanceClock(200);
+  bounceTo(false);
+  advanceClock(DEBOUNCE_MS);
+  TEST_ASSERT_TRUE(poll(event));
+  TEST_ASSERT_EQUAL(BUTTON_RELEASED, event.type);
+  TEST_ASSERT_EQUAL(DEBOUNCE_MS + 200 + 6, event.duration); // From the last edge of the press to the last of the release
+  TEST_ASSERT_FALSE(poll(event));
+}
+
+void test_held_is_sent_once()
+{
+  button_event event;
+  bounceTo(true);
+  advanceClock(DEBOUNCE_MS);
+  TEST_ASSERT_TRUE(poll(event));
+  advanceClock(HOLD_MS - DEBOUNCE_MS - 1);
+  TEST_ASSERT_FALSE(poll(event));
+  advanceClock(1);
+  TEST_ASSERT_TRUE(poll(event));
+  TEST_ASSERT_EQUAL(BUTTON_HELD, event.type);
+  TEST_ASSERT_EQUAL(HOLD_MS, event.duration);
+  advanceClock(HOLD_MS);
+  TEST_ASSERT_FALSE(poll(event));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_chatter_is_one_press_once_settled);
+  RUN_TEST(test_chatter_that_ends_where_it_started_is_nothing);
+  RUN_TEST(test_release_reports_how_long_it_was_down);
+  RUN_TEST(test_held_is_sent_once);
+  return UNITY_END();
+}
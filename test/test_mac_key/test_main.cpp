@@ -0,0 +1,74 @@
+/**
+ * @brief MacKey's byte order, which sorting, the wire format and every dock's agreement on peer order depend on
+ *
+ */
+
+#include <unity.h>
+#include <string.h>
+#include "../dockUnderTest.h"
+
+static const uint8_t BYTES[6] = {0x5C, 0xCF, 0x7F, 0x12, 0x34, 0x56};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_first_byte_is_most_significant()
+{
+  TEST_ASSERT_EQUAL(0x5CCF7F123456ull, MacKey(BYTES).value);
+  TEST_ASSERT_EQUAL(0x5CCF7F123456ull, MacKey::fromBytes(BYTES).value);
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    TEST_ASSERT_EQUAL(BYTES[i], MacKey(BYTES).byte(i));
+  }
+}
+
+void test_bytes_round_trip()
+{
+  uint8_t out[6];
+  MacKey::fromBytes(BYTES).toBytes(out);
+  TEST_ASSERT_EQUAL(0, memcmp(BYTES, out, 6));
+
+  mac_bytes wire;
+  wire = MacKey(BYTES);
+  TEST_ASSERT_EQUAL(0, memcmp(BYTES, wire.bytes, 6));
+  TEST_ASSERT_TRUE((MacKey)wire == MacKey(BYTES));
+}
+
+void test_order_matches_memcmp()
+{
+  static const uint8_t MACS[][6] = {{0x00, 0x00, 0x00, 0x00, 0x00, 0x01}, {0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+                                    {0x01, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x5C, 0xCF, 0x7F, 0x12, 0x34, 0x55},
+                                    {0x5C, 0xCF, 0x7F, 0x12, 0x34, 0x56}, {0xFF, 0x00, 0x00, 0x00, 0x00, 0x00}};
+  const uint8_t count = sizeof(MACS) / sizeof(MACS[0]);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    for (uint8_t j = 0; j < count; j++)
+    {
+      int bytewise = memcmp(MACS[i], MACS[j], 6);
+      TEST_ASSERT_EQUAL(bytewise < 0, MacKey(MACS[i]) < MacKey(MACS[j]));
+      TEST_ASSERT_EQUAL(bytewise > 0, MacKey(MACS[i]) > MacKey(MACS[j]));
+      TEST_ASSERT_EQUAL(bytewise == 0, MacKey(MACS[i]) == MacKey(MACS[j]));
+    }
+  }
+}
+
+void test_only_48_bits_are_kept()
+{
+  TEST_ASSERT_EQUAL(0x5CCF7F123456ull, MacKey(0xABCD5CCF7F123456ull).value);
+  TEST_ASSERT_TRUE(MacKey(0xFFFFFFFFFFFFFFFFull) == BROADCAST_ADDRESS);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_byte_is_most_significant);
+  RUN_TEST(test_bytes_round_trip);
+  RUN_TEST(test_order_matches_memcmp);
+  RUN_TEST(test_only_48_bits_are_kept);
+  return UNITY_END();
+}
@@ -0,0 +1,117 @@
+/**
+ * @brief PeerTable's two orders, its lookups, and the digest every dock compares during catch up
+ *
+ */
+
+#include <unity.h>
+#include "../dockUnderTest.h"
+
+static const MacKey A = MacKey(0x5CCF7F000001ull);
+static const MacKey B = MacKey(0x5CCF7F000002ull);
+static const MacKey C = MacKey(0x5CCF7F000003ull);
+static const MacKey D = MacKey(0x5CCF7F000004ull);
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_insert_keeps_arrival_order()
+{
+  PeerTable<4> table;
+  TEST_ASSERT_EQUAL(PEER_ADDED, table.insert(C));
+  TEST_ASSERT_EQUAL(PEER_ADDED, table.insert(A));
+  TEST_ASSERT_EQUAL(PEER_ADDED, table.insert(B));
+  TEST_ASSERT_TRUE(table.at(0) == C);
+  TEST_ASSERT_TRUE(table.at(1) == A);
+  TEST_ASSERT_TRUE(table.at(2) == B);
+  TEST_ASSERT_EQUAL(0, table.indexOf(C));
+  TEST_ASSERT_EQUAL(1, table.indexOf(A));
+  TEST_ASSERT_EQUAL(2, table.indexOf(B));
+  TEST_ASSERT_EQUAL(-1, table.indexOf(D));
+}
+
+void test_insert_sorted_keeps_ascending_order()
+{
+  PeerTable<4> table;
+  MacKey arrivals[] = {D, B, A, C};
+  for (MacKey peer : arrivals)
+  {
+    TEST_ASSERT_EQUAL(PEER_ADDED, table.insertSorted(peer));
+  }
+  MacKey sorted[] = {A, B, C, D};
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    TEST_ASSERT_TRUE(table.at(i) == sorted[i]);
+    TEST_ASSERT_EQUAL(i, table.indexOf(sorted[i]));
+  }
+}
+
+void test_duplicates_and_overflow_are_refused()
+{
+  PeerTable<2> table;
+  TEST_ASSERT_EQUAL(PEER_ADDED, table.insertSorted(B));
+  TEST_ASSERT_EQUAL(PEER_PRESENT, table.insertSorted(B));
+  TEST_ASSERT_EQUAL(PEER_ADDED, table.insert(A));
+  TEST_ASSERT_EQUAL(PEER_PRESENT, table.insert(A));
+  TEST_ASSERT_EQUAL(PEER_FULL, table.insert(C));
+  TEST_ASSERT_EQUAL(PEER_FULL, table.insertSorted(C));
+  TEST_ASSERT_EQUAL(2, table.count());
+  TEST_ASSERT_FALSE(table.contains(C));
+}
+
+void test_digest_ignores_order()
+{
+  PeerTable<4> sorted, arrived;
+  MacKey arrivals[] = {C, A, D, B};
+  for (MacKey peer : arrivals)
+  {
+    sorted.insertSorted(peer);
+    arrived.insert(peer);
+  }
+  TEST_ASSERT_EQUAL(sorted.digest(), arrived.digest());
+}
+
+void test_digest_tells_sets_apart()
+{
+  PeerTable<4> three, four, other;
+  MacKey peers[] = {A, B, C};
+  for (MacKey peer : peers)
+  {
+    three.insertSorted(peer);
+    four.insertSorted(peer);
+  }
+  four.insertSorted(D);
+  other.insertSorted(A);
+  other.insertSorted(B);
+  other.insertSorted(D);
+  TEST_ASSERT_FALSE(three.digest() == four.digest());
+  TEST_ASSERT_FALSE(three.digest() == other.digest());
+}
+
+void test_clear_empties_the_table()
+{
+  PeerTable<4> table;
+  table.insertSorted(A);
+  table.insertSorted(B);
+  table.clear();
+  TEST_ASSERT_EQUAL(0, table.count());
+  TEST_ASSERT_EQUAL(-1, table.indexOf(A));
+  TEST_ASSERT_EQUAL(PEER_ADDED, table.insertSorted(B));
+  TEST_ASSERT_EQUAL(0, table.indexOf(B));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_insert_keeps_arrival_order);
+  RUN_TEST(test_insert_sorted_keeps_ascending_order);
+  RUN_TEST(test_duplicates_and_overflow_are_refused);
+  RUN_TEST(test_digest_ignores_order);
+  RUN_TEST(test_digest_tells_sets_apart);
+  RUN_TEST(test_clear_empties_the_table);
+  return UNITY_END();
+}
@@ -0,0 +1,155 @@
+/**
+ * @brief DuplicateFilter, and what handleMessage() does with the frames it can't place
+ *
+ */
+
+#include <unity.h>
+#include "../dockUnderTest.h"
+
+using namespace gamedock;
+
+static const MacKey SENDER = MacKey(0x5CCF7F000001ull);
+
+void setUp()
+{
+  runAsDock([] { g_seenFrames.clear(); });
+}
+
+void tearDown()
+{
+}
+
+/**
+ * @brief see every sequence number from first to last except skipped, which is lost the first time
+ *
+ */
+static void seeAllBut(uint8_t first, uint8_t last, uint8_t skipped)
+{
+  for (uint8_t seq = first;; seq++)
+  {
+    if (seq != skipped)
+    {
+      TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(SENDER, seq));
+    }
+    if (seq == last)
+    {
+      break;
+    }
+  }
+}
+
+void test_retransmit_within_window_is_new_once()
+{
+  runAsDock([] {
+    seeAllBut(0, 10, 5);
+    TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(SENDER, 5));
+    TEST_ASSERT_EQUAL(SEQ_DUPLICATE, g_seenFrames.check(SENDER, 5));
+    TEST_ASSERT_EQUAL(SEQ_DUPLICATE, g_seenFrames.check(SENDER, 10));
+  });
+}
+
+void test_retransmit_more_than_32_late_is_new_once()
+{
+  runAsDock([] {
+    seeAllBut(0, 45, 5); // The retransmit of 5 arrives 40 numbers behind the newest
+    TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(SENDER, 5));
+    TEST_ASSERT_EQUAL(SEQ_DUPLICATE, g_seenFrames.check(SENDER, 5));
+  });
+}
+
+void test_retransmit_beyond_window_is_stale()
+{
+  runAsDock([] {
+    seeAllBut(0, 5 + SEQ_WINDOW_BITS, 5);
+    TEST_ASSERT_EQUAL(SEQ_STALE, g_seenFrames.check(SENDER, 5));
+  });
+}
+
+void test_window_follows_wrapping_sequence_numbers()
+{
+  runAsDock([] {
+    seeAllBut(230, 20, 250); // 250 arrives 26 behind 20, across the wrap
+    TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(SENDER, 250));
+    TEST_ASSERT_EQUAL(SEQ_DUPLICATE, g_seenFrames.check(SENDER, 250));
+  });
+}
+
+/**
+ * @brief a different sender for each index
+ *
+ */
+static MacKey sender(uint8_t index)
+{
+  return MacKey(0x5CCF7F000100ull + index);
+}
+
+void test_every_sender_has_its_own_window()
+{
+  runAsDock([] {
+    for (uint8_t i = 0; i < MAX_PEERS; i++)
+    {
+      TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(sender(i), 7));
+    }
+    for (uint8_t i = 0; i < MAX_PEERS; i++)
+    {
+      TEST_ASSERT_EQUAL(SEQ_DUPLICATE, g_seenFrames.check(sender(i), 7));
+    }
+    TEST_ASSERT_EQUAL(MAX_PEERS, g_seenFrames.count());
+  });
+}
+
+void test_sender_heard_longest_ago_is_replaced_when_full()
+{
+  for (uint8_t i = 0; i < MAX_PEERS; i++)
+  {
+    runAsDock([i] { TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(sender(i), 7)); });
+    advanceClock(1);
+  }
+  runAsDock([] {
+    TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(sender(MAX_PEERS), 7)); // Replaces sender 0
+    TEST_ASSERT_EQUAL(MAX_PEERS, g_seenFrames.count());
+    for (uint8_t i = 1; i <= MAX_PEERS; i++) // Everyone else is still found
+    {
+      TEST_ASSERT_EQUAL(SEQ_DUPLICATE, g_seenFrames.check(sender(i), 7));
+    }
+    TEST_ASSERT_EQUAL(SEQ_NEW, g_seenFrames.check(sender(0), 7));
+  });
+}
+
+void test_stale_turn_order_is_still_registered()
+{
+  runAsDock([] {
+    MacKey peers[] = {SENDER, MacKey(0x5CCF7F000002ull), MacKey(0x5CCF7F000003ull)};
+    g_peers.clear();
+    for (MacKey peer : peers)
+    {
+      g_peers.insertSorted(peer);
+    }
+    g_loopPhase = PHASE_ORDER;
+    g_syncedPeers = 3;
+    g_turnOrderChosen = 0;
+    seeAllBut(0, 5 + SEQ_WINDOW_BITS, 5);
+
+    autosync_packet turnOrder = makeAddressPacket(MSG_TURN_ORDER, SENDER);
+    turnOrder.header.seq = 5;
+    turnOrder.header.type |= MSG_RESEND_FLAG;
+    handleMessage(SENDER, turnOrder.bytes, turnOrder.length, NULL);
+    TEST_ASSERT_EQUAL(1, turnOrderCount());
+
+    handleMessage(SENDER, turnOrder.bytes, turnOrder.length, NULL); // Still stale, and registerTurnOrder() ignores it
+    TEST_ASSERT_EQUAL(1, turnOrderCount());
+  });
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_retransmit_within_window_is_new_once);
+  RUN_TEST(test_retransmit_more_than_32_late_is_new_once);
+  RUN_TEST(test_retransmit_beyond_window_is_stale);
+  RUN_TEST(test_window_follows_wrapping_sequence_numbers);
+  RUN_TEST(test_every_sender_has_its_own_window);
+  RUN_TEST(test_sender_heard_longest_ago_is_replaced_when_full);
+  RUN_TEST(test_stale_turn_order_is_still_registered);
+  return UNITY_END();
+}
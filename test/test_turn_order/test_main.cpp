@@ -0,0 +1,117 @@
+/**
+ * @brief registering turn orders, including the ones that arrive before order selection starts
+ *
+ */
+
+#include <unity.h>
+#include "../dockUnderTest.h"
+
+using namespace gamedock;
+
+static const MacKey PEERS[] = {MacKey(0x5CCF7F000001ull), MacKey(0x5CCF7F000002ull), MacKey(0x5CCF7F000003ull),
+                               MacKey(0x5CCF7F000004ull)};
+static const uint8_t PEER_COUNT = sizeof(PEERS) / sizeof(PEERS[0]);
+
+/**
+ * @brief four synced peers, still catching up, with nothing chosen
+ *
+ */
+void setUp()
+{
+  runAsDock([] {
+    g_peers.clear();
+    for (MacKey peer : PEERS)
+    {
+      g_peers.insertSorted(peer);
+    }
+    g_loopPhase = PHASE_CATCH_UP;
+    g_syncedPeers = 0;
+    g_turnOrderChosen = 0;
+    g_earlyTurnOrderCount = 0;
+  });
+}
+
+void tearDown()
+{
+}
+
+/**
+ * @brief freeze the player count and register the first player, as initializeFirstPlayer() and startOrderSelection() do
+ *
+ */
+static void startChoosing(MacKey firstPlayer)
+{
+  g_syncedPeers = g_peers.count();
+  g_firstPlayer = firstPlayer;
+  startOrderSelection();
+}
+
+void test_turn_orders_are_registered_in_order()
+{
+  runAsDock([] {
+    startChoosing(PEERS[2]);
+    registerTurnOrder(PEERS[0]);
+    TEST_ASSERT_EQUAL(2, turnOrderCount());
+    TEST_ASSERT_EQUAL(2, g_turnOrder[0]);
+    TEST_ASSERT_EQUAL(0, g_turnOrder[1]);
+  });
+}
+
+void test_duplicate_turn_order_is_ignored()
+{
+  runAsDock([] {
+    startChoosing(PEERS[2]);
+    registerTurnOrder(PEERS[0]);
+    registerTurnOrder(PEERS[2]);
+    registerTurnOrder(PEERS[0]);
+    TEST_ASSERT_EQUAL(2, turnOrderCount());
+  });
+}
+
+void test_last_peer_is_assigned()
+{
+  runAsDock([] {
+    startChoosing(PEERS[3]);
+    registerTurnOrder(PEERS[1]);
+    registerTurnOrder(PEERS[0]);
+    TEST_ASSERT_EQUAL(PEER_COUNT, turnOrderCount());
+    TEST_ASSERT_EQUAL(2, g_turnOrder[3]);
+    TEST_ASSERT_TRUE(allSelected());
+  });
+}
+
+void test_unknown_dock_is_not_registered()
+{
+  runAsDock([] {
+    startChoosing(PEERS[0]);
+    registerTurnOrder(MacKey(0x5CCF7F000009ull));
+    TEST_ASSERT_EQUAL(1, turnOrderCount());
+  });
+}
+
+void test_turn_order_before_order_selection_is_kept()
+{
+  runAsDock([] {
+    registerTurnOrder(PEERS[1]); // The first player, which finished catching up before we did
+    registerTurnOrder(PEERS[3]);
+    TEST_ASSERT_EQUAL(0, turnOrderCount());
+
+    g_peers.insertSorted(MacKey(0x5CCF7F000000ull)); // Heard late, so every index moves up one
+    startChoosing(PEERS[1]);
+    TEST_ASSERT_EQUAL(2, turnOrderCount());
+    TEST_ASSERT_EQUAL(2, g_turnOrder[0]);
+    TEST_ASSERT_EQUAL(4, g_turnOrder[1]);
+    TEST_ASSERT_EQUAL(0, g_earlyTurnOrderCount);
+  });
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_turn_orders_are_registered_in_order);
+  RUN_TEST(test_duplicate_turn_order_is_ignored);
+  RUN_TEST(test_last_peer_is_assigned);
+  RUN_TEST(test_unknown_dock_is_not_registered);
+  RUN_TEST(test_turn_order_before_order_selection_is_kept);
+  return UNITY_END();
+}
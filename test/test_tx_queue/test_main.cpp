@@ -0,0 +1,142 @@
+/**
+ * @brief the order the transmit queue puts messages on the air in
+ *
+ */
+
+#include <unity.h>
+#include "../dockUnderTest.h"
+
+using namespace gamedock;
+
+static const MacKey PEER = MacKey(0x5CCF7F000002ull);
+
+/**
+ * @brief one link peer, an empty queue, and no batching delay, so serviceTxQueue() sends whatever is ready at once
+ *
+ * g_txBatch is zeroed so the records of the one frame each test sends end at the first zero length.
+ *
+ */
+void setUp()
+{
+  runAsDock([] {
+    clearLinkPeers();
+    addLinkPeer(PEER);
+    TX_BATCH_WINDOW_MS = 0;
+    memset(&g_txBatch, 0, sizeof(g_txBatch));
+    g_peers.clear();
+    g_peers.insertSorted(MacKey(0x5CCF7F000001ull));
+    g_peers.insertSorted(MacKey(0x5CCF7F000003ull));
+  });
+}
+
+void tearDown()
+{
+}
+
+/**
+ * @brief send the next frame and list the purposes of the messages in it, in order
+ *
+ * @return how many messages the frame held
+ */
+static uint8_t sendNextFrame(uint8_t *types)
+{
+  serviceTxQueue();
+  TEST_ASSERT_EQUAL(MSG_BATCH, g_txBatch.header.type);
+  uint8_t count = 0;
+  for (uint8_t offset = 0; offset < ESPNOW_MAX_FRAME - sizeof(msg_header) && g_txBatch.records[offset] != 0;
+       offset += 1 + g_txBatch.records[offset])
+  {
+    types[count++] = g_txBatch.records[offset + 1] & MSG_TYPE_MASK;
+  }
+  return count;
+}
+
+void test_digest_goes_after_delta_queued_before_it()
+{
+  runAsDock([] {
+    PeerTable<MAX_PEERS> theirs;
+    sendPeerList(1, &theirs);
+    sendPeerDigest(1);
+    uint8_t types[TX_QUEUE_SIZE];
+    TEST_ASSERT_EQUAL(2, sendNextFrame(types));
+    TEST_ASSERT_EQUAL(MSG_PEER_DELTA, types[0]);
+    TEST_ASSERT_EQUAL(MSG_PEER_DIGEST, types[1]);
+  });
+}
+
+void test_superseding_digest_goes_after_delta_queued_before_it()
+{
+  runAsDock([] {
+    PeerTable<MAX_PEERS> theirs;
+    sendPeerDigest(1);
+    sendPeerList(1, &theirs);
+    g_peers.insertSorted(MacKey(0x5CCF7F000004ull)); // A new digest replaces the one queued before the delta
+    sendPeerDigest(1);
+    uint8_t types[TX_QUEUE_SIZE];
+    TEST_ASSERT_EQUAL(2, sendNextFrame(types));
+    TEST_ASSERT_EQUAL(MSG_PEER_DELTA, types[0]);
+    TEST_ASSERT_EQUAL(MSG_PEER_DIGEST, types[1]);
+  });
+}
+
+void test_turn_messages_go_first()
+{
+  runAsDock([] {
+    sendPeerDigest(1);
+    sendPacket(makeAddressPacket(MSG_TURN_ORDER, PEER), true);
+    uint8_t types[TX_QUEUE_SIZE];
+    TEST_ASSERT_EQUAL(2, sendNextFrame(types));
+    TEST_ASSERT_EQUAL(MSG_TURN_ORDER, types[0]);
+    TEST_ASSERT_EQUAL(MSG_PEER_DIGEST, types[1]);
+  });
+}
+
+void test_late_result_is_not_credited_to_next_send()
+{
+  runAsDock([] {
+    sendPeerDigest(1);
+    serviceTxQueue();
+    g_txSentAt = millis() - TX_RESULT_TIMEOUT_MS - 1; // Nothing reported on the digest in time
+    serviceTxQueue();
+    TEST_ASSERT_EQUAL(0, g_txInFlight);
+
+    sendPacket(makeAddressPacket(MSG_TURN_ORDER, PEER), true);
+    serviceTxQueue();
+    TEST_ASSERT_EQUAL(0, g_txInFlight); // The radio is still sending the digest
+    recordTxResult(PEER, true);         // The digest's result, late
+    TEST_ASSERT_EQUAL(0, g_txInFlight);
+
+    serviceTxQueue();
+    TEST_ASSERT_EQUAL(1, g_txAwaiting);
+    recordTxResult(PEER, true); // The turn order's
+    TEST_ASSERT_EQUAL(0, g_txAwaiting);
+  });
+}
+
+void test_late_result_that_never_comes_is_written_off()
+{
+  runAsDock([] {
+    sendPeerDigest(1);
+    serviceTxQueue();
+    g_txSentAt = millis() - TX_RESULT_TIMEOUT_MS - 1;
+    serviceTxQueue();
+
+    sendPacket(makeAddressPacket(MSG_TURN_ORDER, PEER), true);
+    g_txLateUntil = millis(); // No result for the digest by the time the radio is handed the next frame
+    serviceTxQueue();
+    TEST_ASSERT_EQUAL(1, g_txAwaiting);
+    recordTxResult(PEER, true);
+    TEST_ASSERT_EQUAL(0, g_txAwaiting);
+  });
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_digest_goes_after_delta_queued_before_it);
+  RUN_TEST(test_superseding_digest_goes_after_delta_queued_before_it);
+  RUN_TEST(test_turn_messages_go_first);
+  RUN_TEST(test_late_result_is_not_credited_to_next_send);
+  RUN_TEST(test_late_result_that_never_comes_is_written_off);
+  return UNITY_END();
+}
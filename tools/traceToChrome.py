@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Turn GameDock trace dumps into Chrome trace_event JSON.
+
+Give it serial logs from docks that were sent the trace command, or a file written by gamedock-sim --trace, or
+both. Open the result in chrome://tracing or https://ui.perfetto.dev, with one process per dock.
+
+    tools/traceToChrome.py dock1.log dock2.log -o trace.json
+    gamedock-sim --docks 8 --trace sim-trace.txt && tools/traceToChrome.py sim-trace.txt -o trace.json
+
+Every dock counts micros() from its own boot, so the timelines are lined up by matching frames: a dispatch on one
+dock is the same frame as the transmit with the same sender and sequence number on another. The most common
+difference between the two clocks is taken as their offset, refined to the smallest difference near it, which is
+the frame with the least queueing. Docks that never heard from the others are left on their own clocks.
+"""
+
+import argparse
+import collections
+import json
+import re
+import sys
+
+MSG_RESEND_FLAG = 0x80
+MSG_TYPE_MASK = 0x7F
+WRAP = 1 << 32
+
+# In the simulator's output every line starts with the time and the dock it came from
+SOURCE = re.compile(r"(dock\d+) \|")
+
+
+def parse(paths):
+    """Read every dump, returning {mac: [(time, kind, name, arg, value)]} in the order they were recorded.
+
+    Times are unwrapped. When a dock was dumped more than once, a later dump only adds what came after the last
+    record already read, so the overlap isn't repeated.
+    """
+    docks = collections.defaultdict(list)
+    for path in paths:
+        dumps = {}  # The dump in progress from each source in this file: [mac, last time, wraps, time already read]
+        with open(path, errors="replace") as file:
+            for line in file:
+                start = line.find("trace")
+                if start < 0:
+                    continue
+                source = SOURCE.search(line[:start])
+                source = source.group(1) if source else path
+                fields = line[start:].strip().split(",")
+                if fields[0] == "trace begin" and len(fields) >= 2:
+                    records = docks[fields[1]]
+                    dumps[source] = [fields[1], None, 0, records[-1][0] if records else None]
+                elif fields[0] == "trace end":
+                    dumps.pop(source, None)
+                elif fields[0] == "trace" and len(fields) == 6 and source in dumps:
+                    dump = dumps[source]
+                    try:
+                        time, arg, value = int(fields[1]), int(fields[4]), int(fields[5])
+                    except ValueError:
+                        continue  # Garbled on the way over the serial line
+                    if dump[1] is not None and time < dump[1] - WRAP // 2:  # micros() wrapped
+                        dump[2] += 1
+                    dump[1] = time
+                    time += dump[2] * WRAP
+                    if dump[3] is None or time > dump[3]:
+                        docks[dump[0]].append((time, fields[2], fields[3], arg, value))
+    return docks
+
+
+def mac24(mac):
+    return int(mac.replace(":", ""), 16) & 0xFFFFFF
+
+
+def offsets(docks):
+    """The clock offset of every dock that can be lined up with the first one, added to its times."""
+    sends = {}
+    receives = {}
+    for mac, records in docks.items():
+        sends[mac] = collections.defaultdict(list)
+        receives[mac] = collections.defaultdict(list)
+        for time, kind, name, arg, value in records:
+            if kind == "B" and name == "transmit":
+                sends[mac][value & 0xFF].append(time)
+            elif kind == "B" and name == "dispatch":
+                receives[mac][(value >> 8, value & 0xFF)].append(time)
+
+    # How far each receiver's clock is ahead of each sender's
+    ahead = {}
+    by24 = {mac24(mac): mac for mac in docks}
+    for receiver in docks:
+        differences = collections.defaultdict(list)
+        for (sender24, seq), times in receives[receiver].items():
+            sender = by24.get(sender24)
+            if sender is None or sender == receiver:
+                continue
+            for received in times:
+                differences[sender].extend(received - sent for sent in sends[sender][seq])
+        for sender, values in differences.items():
+            buckets = collections.Counter(value // 1000 for value in values)
+            bucket = max(buckets, key=lambda b: (buckets[b], -b))
+            near = [value for value in values if abs(value // 1000 - bucket) <= 5]
+            ahead[(sender, receiver)] = min(near)
+
+    macs = sorted(docks)
+    shift = {macs[0]: 0}
+    queue = [macs[0]]
+    while queue:
+        known = queue.pop(0)
+        for (sender, receiver), difference in ahead.items():
+            if sender == known and receiver not in shift:
+                shift[receiver] = shift[known] - difference
+                queue.append(receiver)
+            elif receiver == known and sender not in shift:
+                shift[sender] = shift[known] + difference
+                queue.append(sender)
+    for mac in macs:
+        if mac not in shift:
+            print("traceToChrome: %s never heard from the others, left on its own clock" % mac, file=sys.stderr)
+            shift[mac] = 0
+    return shift
+
+
+def describe(name, arg, value):
+    """The args shown for an event in the viewer."""
+    if name in ("transmit", "dispatch"):
+        args = {"purpose": arg & MSG_TYPE_MASK, "resend": bool(arg & MSG_RESEND_FLAG), "seq": value & 0xFF}
+        if name == "dispatch":
+            args["sender"] = "..:%02x:%02x:%02x" % ((value >> 24) & 0xFF, (value >> 16) & 0xFF, (value >> 8) & 0xFF)
+        return args
+    if name == "passTurn":
+        return {"player": arg - 0x10000 if arg >= 0x8000 else arg}
+    if name == "led":
+        return {"pin": arg, "level": value}
+    return {"arg": arg, "value": value}
+
+
+def convert(docks, align):
+    shift = offsets(docks) if align else {mac: 0 for mac in docks}
+    events = []
+    origin = min((time + shift[mac] for mac, records in docks.items() for time, *_ in records), default=0)
+    for pid, mac in enumerate(sorted(docks)):
+        events.append({"name": "process_name", "ph": "M", "pid": pid, "args": {"name": mac}})
+        depth = 0
+        for time, kind, name, arg, value in docks[mac]:
+            if kind == "E" and depth == 0:
+                continue  # The buffer starts part way through a span
+            depth += 1 if kind == "B" else -1 if kind == "E" else 0
+            event = {"name": name, "ph": kind, "ts": time + shift[mac] - origin, "pid": pid, "tid": 0,
+                     "args": describe(name, arg, value)}
+            if kind == "i":
+                event["s"] = "p"
+            events.append(event)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("logs", nargs="+", help="serial logs or gamedock-sim --trace files")
+    parser.add_argument("-o", "--output", help="where to write the JSON, stdout by default")
+    parser.add_argument("--no-align", action="store_true", help="leave every dock on its own clock")
+    args = parser.parse_args()
+
+    docks = parse(args.logs)
+    if not docks:
+        sys.exit("traceToChrome: no trace dumps found")
+    trace = convert(docks, not args.no_align)
+    if args.output:
+        with open(args.output, "w") as file:
+            json.dump(trace, file)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()